@@ -0,0 +1,70 @@
+#ifndef ARENA_ALLOCATOR_H
+#define ARENA_ALLOCATOR_H
+
+#include "MemoryManager.h"
+#include <vector>
+#include <unordered_map>
+
+// Region (arena) allocator. Objects are bump-allocated out of chunks carved
+// from the block heap; a request that does not fit the current chunk opens a
+// new one and the old chunk's tail is wasted. Arenas nest as a stack of
+// marks on the chunk chain: "arena begin" pushes a mark and "arena reset"
+// frees everything allocated since the innermost mark in one step.
+class ArenaAllocator : public MemoryManager {
+private:
+    static const size_t DEFAULT_CHUNK_SIZE = 4096;
+    static const size_t ALIGN_SIZE = 8;
+
+    struct Chunk {
+        BlockIter block;      // Backing block in the heap
+        size_t size;
+        size_t used;          // Bump offset
+        size_t live;          // Bytes of objects not yet freed
+    };
+
+    // Position on the chunk chain where an arena starts
+    struct Mark {
+        size_t chunkCount;
+        size_t used;          // Bump offset in the last chunk at that time
+        size_t logSize;       // Allocations made before the arena began
+    };
+
+    struct ObjectRef {
+        size_t chunk;
+        size_t offset;
+        size_t size;          // Aligned size taken from the chunk
+        size_t requested;
+        size_t depth;         // Arena the object belongs to
+    };
+
+    size_t chunkSize;
+    std::vector<Chunk> chunks;
+    std::vector<Mark> arenas;                     // arenas[0] is the outermost
+    std::vector<int> allocationLog;               // Ids in allocation order
+    std::unordered_map<int, ObjectRef> objects;
+
+    size_t liveBytes;
+    size_t paddingBytes;
+    size_t resets;
+    size_t resetObjects;
+    size_t chunksCreated;
+
+public:
+    ArenaAllocator(size_t size);
+
+    bool allocate(size_t size) override;
+    bool deallocate(int blockId) override;
+    void dumpMemory() override;
+    void showStats() override;
+
+    void beginArena();
+    void resetArena();
+    size_t depth() const { return arenas.size() - 1; }
+
+private:
+    bool newChunk(size_t minSize);
+    void forgetObject(std::unordered_map<int, ObjectRef>::iterator it);
+    size_t tailWaste() const;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef BIT_OPS_H
+#define BIT_OPS_H
+
+#include <cstdint>
+
+// Find-first-set / find-last-set on 64-bit words. Both return -1 for 0.
+// GCC/Clang (and MinGW) map these to single bsf/bsr/tzcnt/lzcnt instructions.
+
+inline int findFirstSet(uint64_t word) {
+#if defined(__GNUC__)
+    return word ? __builtin_ctzll(word) : -1;
+#else
+    if (!word) return -1;
+    int bit = 0;
+    while (!(word & 1)) { word >>= 1; bit++; }
+    return bit;
+#endif
+}
+
+inline int findLastSet(uint64_t word) {
+#if defined(__GNUC__)
+    return word ? 63 - __builtin_clzll(word) : -1;
+#else
+    if (!word) return -1;
+    int bit = 0;
+    while (word >>= 1) bit++;
+    return bit;
+#endif
+}
+
+inline int popCount(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    int n = 0;
+    while (word) { word &= word - 1; n++; }
+    return n;
+#endif
+}
+
+#endif
@@ -3,40 +3,67 @@
 
 #include "MemoryManager.h"
 #include <vector>
-#include <list>
-#include <map>
-#include <cmath>
+#include <unordered_map>
+#include <cstdint>
 
 class BuddyAllocator : public MemoryManager {
 private:
-    // Array of free lists. freeLists[k] stores free blocks of order k (size 2^k)
-    std::vector<std::list<MemoryBlock>> freeLists;
-    
-    // Map to track allocated blocks: Address -> Order (Block Size)
-    std::map<size_t, int> allocatedBlockMap;
-    
-    // Map to track allocated blocks: ID -> Address (To support free by ID)
-    std::map<int, size_t> idToAddressMap;
-
-    // NEW: Map to track original requested size: ID -> Requested Size
-    // Essential for calculating Internal Fragmentation
-    std::map<int, size_t> requestedSizeMap;
+    static const uint32_t NIL = 0xFFFFFFFFu;
+    static const uint8_t NO_BLOCK = 0xFF;
 
+    // All metadata is indexed by minimum-block number (address >> minOrder).
+    // Heaps above 2^MAX_TRACKED_BITS minimum blocks get a larger minimum block
+    // so the metadata stays bounded.
+    static const int MAX_TRACKED_BITS = 20;
+
+    int minOrder;   // log2(minimum block size)
+    int maxOrder;   // log2(heap size)
     size_t minBlockSize;
-    int maxOrder;
+
+    // freeBitmap[k] has one bit per order-k block: set while it sits in a free list.
+    // Checking whether a buddy is free is a single bit test.
+    std::vector<std::vector<uint64_t>> freeBitmap;
+
+    // Intrusive FIFO free lists threaded through flat link arrays
+    std::vector<uint32_t> freeHead;
+    std::vector<uint32_t> freeTail;
+    std::vector<uint32_t> nextFree;
+    std::vector<uint32_t> prevFree;
+    std::vector<size_t> freeCount;
+
+    // Allocated blocks, stored at their first minimum block
+    std::vector<uint8_t> blockOrder;     // NO_BLOCK unless an allocation starts here
+    std::vector<int> blockId;
+    std::vector<size_t> requestedSize;   // Original request, for internal fragmentation
+
+    std::unordered_map<int, uint32_t> idToIndex; // Free by id
+
+    // Running totals so showStats does not walk the heap
+    size_t usedMemory;
+    size_t usedBlocks;
+    size_t internalFrag;
 
 public:
     BuddyAllocator(size_t size);
-    
+
     // Override the core functions
     bool allocate(size_t size) override;
     bool deallocate(int blockId) override;
     void dumpMemory() override;
-    void showStats() override; 
+    void showStats() override;
 
 private:
     void initializeBuddy();
     int getOrder(size_t size);
+
+    size_t blockBytes(int order) const { return (size_t)1 << order; }
+    uint32_t blockSpan(int order) const { return (uint32_t)1 << (order - minOrder); }
+    size_t blockAddress(uint32_t index) const { return (size_t)index << minOrder; }
+
+    bool isFree(int order, uint32_t index) const;
+    void pushFree(int order, uint32_t index);
+    uint32_t popFree(int order);
+    void removeFree(int order, uint32_t index);
 };
 
-#endif
\ No newline at end of file
+#endif
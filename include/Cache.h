@@ -6,74 +6,251 @@
 #include <cmath>
 #include <iostream>
 #include <iomanip>
+#include <cstdint>
+#include <unordered_map>
+#include "EventLog.h"
+#include "Prefetcher.h"
 
-// Represents a single line (slot) in the cache
-struct CacheLine {
-    bool valid;             // Is there data here?
-    bool dirty;             // <--- NEW: Has this data been modified?
-    unsigned long tag;      // The ID of the memory block
-    unsigned long lruTime;  // Timestamp for Least Recently Used policy
-    unsigned long insertionTime; // Timestamp for FIFO policy
+enum ReplacementPolicy {
+    POLICY_LRU,         // True LRU
+    POLICY_FIFO,
+    POLICY_PLRU,        // Tree pseudo-LRU (power-of-two associativity)
+    POLICY_SRRIP,
+    POLICY_BRRIP,
+    POLICY_NRU,
+    POLICY_RANDOM       // Seeded, so runs are repeatable
+};
 
-    CacheLine() : valid(false), dirty(false), tag(0), lruTime(0), insertionTime(0) {}
+// Coherence state of a line in a core's private caches. MESI never uses
+// LINE_OWNED; MOESI lets the last writer keep a dirty line that others share.
+enum CoherenceState {
+    LINE_INVALID,
+    LINE_SHARED,
+    LINE_EXCLUSIVE,
+    LINE_OWNED,
+    LINE_MODIFIED
 };
 
-struct CacheSet {
-    std::vector<CacheLine> lines;
+enum CoherenceProtocol { PROTOCOL_MESI, PROTOCOL_MOESI };
+
+// Geometry and policy of one cache level, as given to config cache
+struct CacheShape {
+    size_t size;
+    size_t blockSize;
+    int assoc;
+    ReplacementPolicy policy;
+    unsigned seed;
 };
 
+// Common state and stats of one cache level. The lookup itself lives in a
+// CacheEngine specialization (CacheEngine.h) picked once by create(), so
+// the per-access path never compares policy strings.
 class CacheLevel {
-private:
+protected:
     std::string levelName;  
     size_t cacheSize;       
     size_t blockSize;       
     int associativity;      
-    std::string policy;     
+    ReplacementPolicy policy;
+    EventSource source;     // Tag for structured events
 
     size_t numSets;         
-    std::vector<CacheSet> sets; 
+    int core;               // Core owning a private level, the id of its events
     
     // Statistics
-    int hits;
-    int misses;
-    unsigned long globalTime; 
+    uint64_t hits;
+    uint64_t misses;
+
+    bool victimValid;       // The last miss evicted the valid line at victimAddress
+    uint64_t victimAddress;
+    bool prefetchHit;       // The last access was the first hit on a prefetched line
+
+    CacheLevel(std::string name, size_t size, size_t blockSize, int assoc, ReplacementPolicy policy);
 
 public:
-    CacheLevel(std::string name, size_t size, size_t blockSize, int assoc, std::string policy);
+    static const int MAX_WAYS = 64;     // Per-set valid/dirty state is one 64-bit mask
+
+    virtual ~CacheLevel() {}
+
+    // Picks the fastest engine for this geometry: fully fixed for the
+    // common shapes, shift/mask for power-of-two ones, div/mod otherwise.
+    // Returns nullptr if the geometry holds no complete set, has more than
+    // MAX_WAYS ways, or does not suit the policy (see geometryError).
+    static CacheLevel* create(std::string name, size_t size, size_t blockSize, int assoc,
+                              ReplacementPolicy policy, unsigned seed = 1);
+    static const char* geometryError(size_t size, size_t blockSize, int assoc, ReplacementPolicy policy);
+
+    static bool parsePolicy(const std::string& text, ReplacementPolicy& policy);
+    static const char* policyName(ReplacementPolicy policy);
     
     // Updated to accept isWrite
-    bool access(unsigned long address, bool isWrite);
+    virtual bool access(uint64_t address, bool isWrite) = 0;
+    virtual const char* engineName() const = 0;
+
+    // Fills the line holding address ahead of demand, uncounted and marked
+    // as prefetched until its first hit; false if it is already present.
+    // A valid line it evicts is reported by lastVictim like a miss's.
+    virtual bool prefetch(uint64_t address) = 0;
+
+    // Coherence hooks for the multi-core controller; a line is named by any
+    // byte in it. An absent line reads as LINE_INVALID and is left alone by
+    // setLineState; invalidating keeps the tag so a later miss on it can be
+    // told apart as a coherence miss.
+    virtual CoherenceState lineState(uint64_t address) const = 0;
+    virtual void setLineState(uint64_t address, CoherenceState state) = 0;
+    virtual bool invalidatedLine(uint64_t address) const = 0;
+
+    void setCore(int id) { core = id; }
+    size_t getBlockSize() const { return blockSize; }
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+    bool lastVictim(uint64_t& address) const {
+        address = victimAddress;
+        return victimValid;
+    }
+    bool lastHitPrefetched() const { return prefetchHit; }
+    // Adds other's hits and misses to this level's and clears other's
+    void takeStats(CacheLevel& other) {
+        hits += other.hits;
+        misses += other.misses;
+        other.hits = other.misses = 0;
+    }
     
     void showStats();
-    
-private:
-    void handleReplacement(int setIndex, unsigned long tag);
 };
 
+class ParallelCacheSim;
+
 class CacheController {
 private:
-    CacheLevel* l1;
-    CacheLevel* l2;
-    CacheLevel* l3;
+    // One core's private levels and the requests and cycles charged to it
+    struct Core {
+        CacheLevel* l1;
+        CacheLevel* l2;
+        unsigned long long requests;
+        unsigned long long cycles;
+        uint64_t coherenceMisses;   // Private misses on lines a peer's write invalidated
+        uint64_t invalidations;     // Lines lost to peers' writes
+        Prefetcher* prefetchers[2]; // Of L1 and L2; nullptr when off
+    };
+
+    std::vector<Core> cores;
+    CacheShape shapes[3];           // L1 and L2 are built once per core
+    CacheLevel* l3;                 // Shared by every core
+    int currentCore;
 // NEW: Latency Tracking
     unsigned long long totalAccessCycles;
     unsigned long long totalRequests;
+    unsigned long long translationCycles;   // TLB lookups and page walks
+    unsigned long long swapCycles;          // Page-ins and dirty page write-backs
+
+    // With more than one core, a directory beside the shared L3 records
+    // which cores may hold each private line, so a miss or an upgrade only
+    // snoops those cores
+    CoherenceProtocol protocol;
+    int lineShift;                                      // log2 of the private block size
+    std::unordered_map<uint64_t, uint64_t> directory;   // Line -> one bit per holding core
+    uint64_t upgrades;              // Writes to lines other cores shared
+    uint64_t invalidations;         // Peer copies invalidated
+    uint64_t transfers;             // Misses served from a peer's dirty copy
+    uint64_t coherenceWritebacks;   // MESI: dirty lines written back when a peer reads them
+
+    // Set-sharded copy of the hierarchy run on worker threads; while it
+    // exists every reference goes there and the levels above only collect
+    // its stats
+    ParallelCacheSim* parallel;
+    int parallelThreads;
+    void drainParallel();
+    bool rebuildParallel();
+
+    // Hardware prefetchers, one per level instance (per core for L1/L2)
+    PrefetchConfig prefetchConfigs[3];
+    Prefetcher* l3Prefetcher;
+    std::vector<uint64_t> prefetchCandidates;
+    bool prefetching() const {
+        return prefetchConfigs[0].kind != PREFETCH_OFF || prefetchConfigs[1].kind != PREFETCH_OFF ||
+               prefetchConfigs[2].kind != PREFETCH_OFF;
+    }
+    // After a lookup that level servedBy (1..3, 4 = memory) answered:
+    // credits and times a prefetched hit, trains the levels the reference
+    // reached (train = false for page walks) and issues their proposals.
+    // Returns the cycles a late prefetch still kept the reference waiting.
+    uint64_t runPrefetchers(int c, uint64_t address, int servedBy, bool train);
+    void issuePrefetch(int c, int level, uint64_t line);
+    void showPrefetchStats();
+
+    int lookup(Core& core, uint64_t address, bool isWrite, bool peerSupplies = false, int* servedBy = nullptr) {
+        return lookupLevels(core.l1, core.l2, l3, address, isWrite, peerSupplies, servedBy);
+    }
+
+    // Multi-core: settles the line's coherence state around lookup()
+    int coherentLookup(int c, uint64_t address, bool isWrite, int* servedBy = nullptr);
+    CoherenceState coreState(const Core& core, uint64_t address) const;
+    void setCoreState(Core& core, uint64_t address, CoherenceState state);
+    void invalidatePeer(int p, uint64_t address);
+    void forgetVictims(int c);
+
+    void buildCores(int count);
+    void deleteCores();
 
     // Simulation Constants (Latencies in "Cycles")
-    const int L1_LATENCY = 1;
-    const int L2_LATENCY = 10;
-    const int L3_LATENCY = 100;
-    const int RAM_LATENCY = 500;
+    static const int L1_LATENCY = 1;
+    static const int L2_LATENCY = 10;
+    static const int L3_LATENCY = 100;
+    static const int RAM_LATENCY = 500;
+    static const int TRANSFER_LATENCY = 60;     // Cache-to-cache copy of a dirty line
     
 public:
+    static const int MAX_CORES = 64;    // Directory entries are one 64-bit mask
+
     CacheController();
     ~CacheController();
+
+    // Runs one reference down L1..RAM and returns its cost in cycles; a
+    // peer's dirty copy, when it supplies the line, stands in for RAM.
+    // servedBy, if given, is set to the level that hit (4 = none did).
+    static int lookupLevels(CacheLevel* l1, CacheLevel* l2, CacheLevel* l3, uint64_t address, bool isWrite,
+                            bool peerSupplies = false, int* servedBy = nullptr);
     
     // Updated access signature
-    void accessMemory(unsigned long address, bool isWrite);
+    void accessMemory(uint64_t address, bool isWrite);
+
+    // A page-table read made by the MMU: goes through the same levels but
+    // is charged as translation, not counted as a CPU request
+    void accessPageWalk(uint64_t address);
+    void chargeTranslation(unsigned long long cycles) {
+        translationCycles += cycles;
+        cores[currentCore].cycles += cycles;
+    }
+    void chargeSwap(unsigned long long cycles) {
+        swapCycles += cycles;
+        cores[currentCore].cycles += cycles;
+    }
     
     // NEW: Method to re-configure a specific cache level at runtime
-    void configCache(std::string level, size_t size, size_t blockSize, int assoc, std::string policy);
+    void configCache(std::string level, size_t size, size_t blockSize, int assoc, std::string policy,
+                     unsigned seed = 1);
+
+    // Rebuilds the private levels for count cores, empty, keeping the L3
+    bool configCores(int count, const std::string& protocolName);
+    // Later references run on core c; false if there is no such core
+    bool selectCore(int c);
+    int coreCount() const { return (int)cores.size(); }
+
+    // Simulates the caches on threads worker threads, split by set (0 or 1
+    // = serial). Starts every level empty; false if the shape cannot split.
+    bool configParallel(int threads);
+    int getParallelThreads() const { return parallelThreads; }
+
+    // Puts a prefetcher on a level (every core's copy of L1/L2), replacing
+    // any there; PREFETCH_OFF removes it. False under parallel simulation,
+    // whose set shards a prefetch would cross.
+    bool configPrefetch(const std::string& level, const PrefetchConfig& config);
+
+    // Totals for result tables: a level's hit rate over every core, in
+    // percent (level 1..3), and the AMAT in cycles
+    double hitRate(int level);
+    double amat();
 
     void showStats();
 };
@@ -0,0 +1,221 @@
+#ifndef CACHE_ENGINE_H
+#define CACHE_ENGINE_H
+
+#include "Cache.h"
+#include "BitOps.h"
+#include "TagMatch.h"
+#include "CachePolicies.h"
+#include <cstdint>
+
+// ---------------- Address -> (set, tag) mappings ----------------
+
+// Any geometry: integer divide and modulo
+struct ModuloIndex {
+    size_t blockSize;
+    size_t numSets;
+
+    ModuloIndex(size_t blkSize, size_t sets) : blockSize(blkSize), numSets(sets) {}
+    uint64_t set(uint64_t address) const { return (address / blockSize) % numSets; }
+    uint64_t tag(uint64_t address) const { return address / (blockSize * numSets); }
+    uint64_t blockAddress(uint64_t tag, uint64_t set) const { return (tag * numSets + set) * blockSize; }
+    static const char* name() { return "div/mod"; }
+};
+
+inline int log2Exact(size_t n) {
+    int bits = 0;
+    while (n > 1) { n >>= 1; bits++; }
+    return bits;
+}
+
+inline bool isPowerOfTwo(size_t n) { return n && !(n & (n - 1)); }
+
+// Power-of-two block size and set count: shifts and a mask
+struct ShiftIndex {
+    int blockShift;
+    int tagShift;
+    uint64_t setMask;
+
+    ShiftIndex(size_t blkSize, size_t sets)
+        : blockShift(log2Exact(blkSize)), tagShift(log2Exact(blkSize) + log2Exact(sets)), setMask(sets - 1) {}
+    uint64_t set(uint64_t address) const { return (address >> blockShift) & setMask; }
+    uint64_t tag(uint64_t address) const { return address >> tagShift; }
+    uint64_t blockAddress(uint64_t tag, uint64_t set) const { return (tag << tagShift) | (set << blockShift); }
+    static const char* name() { return "shift/mask"; }
+};
+
+constexpr int constLog2(size_t n) { return n <= 1 ? 0 : 1 + constLog2(n >> 1); }
+
+// Geometry fixed at compile time: the shifts and mask become immediates
+template <size_t BlockSize, size_t NumSets>
+struct FixedIndex {
+    static_assert((BlockSize & (BlockSize - 1)) == 0 && (NumSets & (NumSets - 1)) == 0,
+                  "fixed cache shapes must be powers of two");
+    static const int BLOCK_SHIFT = constLog2(BlockSize);
+    static const int TAG_SHIFT = constLog2(BlockSize) + constLog2(NumSets);
+
+    FixedIndex(size_t, size_t) {}
+    uint64_t set(uint64_t address) const { return (address >> BLOCK_SHIFT) & (NumSets - 1); }
+    uint64_t tag(uint64_t address) const { return address >> TAG_SHIFT; }
+    uint64_t blockAddress(uint64_t tag, uint64_t set) const { return (tag << TAG_SHIFT) | (set << BLOCK_SHIFT); }
+    static const char* name() { return "fixed"; }
+};
+
+// ---------------- Engine ----------------
+
+// One cache level specialised on its policy and index math. Ways > 0 fixes
+// the associativity at compile time so the set loops unroll; 0 reads it
+// from the runtime geometry.
+//
+// Sets are stored as structure-of-arrays: one contiguous tag array with each
+// set's row padded to the SIMD width and valid/dirty bitmasks per set; the
+// policy keeps its own packed per-set state. A lookup is one matchTags()
+// over the row.
+template <typename Policy, typename Index, int Ways = 0>
+class CacheEngine : public CacheLevel {
+private:
+    Index index;
+    int stride;                         // Tag row length, ways rounded up to TAG_LANES
+    uint64_t allWays;                   // Mask with one bit per way
+    std::vector<uint64_t> tags;
+    std::vector<uint64_t> validMask;
+    std::vector<uint64_t> dirtyMask;
+    std::vector<uint64_t> sharedMask;       // Coherence: other cores may hold the line too
+    std::vector<uint64_t> invalidatedMask;  // Coherence: invalid ways whose tag a peer's write took
+    std::vector<uint64_t> prefetchedMask;   // Filled by a prefetch and not hit since
+    Policy replacement;
+
+    int ways() const { return Ways > 0 ? Ways : associativity; }
+
+    uint64_t taggedWays(uint64_t setIndex, uint64_t tag) const {
+        return matchTags(&tags[setIndex * stride], Ways > 0 ? PaddedWays : stride, tag);
+    }
+
+    // Places tag in the set, evicting the victim if the set is full, and
+    // returns the way; tagged holds the ways that already carried the tag
+    int fill(uint64_t setIndex, uint64_t tag, uint64_t tagged, bool isWrite) {
+        victimValid = false;
+        uint64_t empty = ~validMask[setIndex] & allWays;
+        int way = empty ? findFirstSet(empty) : replacement.victim(setIndex);
+        uint64_t bit = (uint64_t)1 << way;
+        uint64_t& victimTag = tags[setIndex * stride + way];
+
+        if (validMask[setIndex] & bit) {
+            // --- WRITE-BACK LOGIC ---
+            bool dirty = (dirtyMask[setIndex] & bit) != 0;
+            victimValid = true;
+            victimAddress = index.blockAddress(victimTag, setIndex);
+            MEMSIM_EVENT(EV_EVICT, source, core, victimAddress, dirty);
+            if (dirty) {
+                MEMSIM_EVENT(EV_WRITEBACK, source, core, victimAddress, blockSize);
+                MEMSIM_LOG(std::cout << "   [!CACHE EVICTION!] " << levelName << ": Writing dirty block 0x"
+                          << std::hex << victimTag << std::dec << " back to Memory." << std::endl);
+            }
+        }
+
+        // Write-allocate leaves the new block dirty
+        victimTag = tag;
+        validMask[setIndex] |= bit;
+        if (isWrite) dirtyMask[setIndex] |= bit;
+        else dirtyMask[setIndex] &= ~bit;
+        sharedMask[setIndex] &= ~bit;
+        invalidatedMask[setIndex] &= ~(tagged | bit);
+        prefetchedMask[setIndex] &= ~bit;
+        replacement.onFill(setIndex, way);
+        return way;
+    }
+
+public:
+    CacheEngine(std::string name, size_t size, size_t blkSize, int assoc, unsigned seed)
+        : CacheLevel(name, size, blkSize, assoc, Policy::kind()), index(blkSize, numSets),
+          stride((assoc + TAG_LANES - 1) / TAG_LANES * TAG_LANES),
+          allWays(assoc >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << assoc) - 1)),
+          tags(numSets * stride, 0), validMask(numSets, 0), dirtyMask(numSets, 0),
+          sharedMask(numSets, 0), invalidatedMask(numSets, 0), prefetchedMask(numSets, 0),
+          replacement(numSets, assoc, seed) {}
+
+    const char* engineName() const override { return Index::name(); }
+
+    bool access(uint64_t address, bool isWrite) override {
+        uint64_t setIndex = index.set(address);
+        uint64_t tag = index.tag(address);
+
+        // 1. Check for HIT
+        uint64_t tagged = taggedWays(setIndex, tag);
+        uint64_t match = tagged & validMask[setIndex];
+        if (match) {
+            int way = findFirstSet(match);
+            hits++;
+            MEMSIM_EVENT(EV_HIT, source, core, address, isWrite);
+            replacement.onHit(setIndex, way);
+            prefetchHit = (prefetchedMask[setIndex] & match) != 0;
+            prefetchedMask[setIndex] &= ~match;
+
+            // --- WRITE POLICY (Write-Back) ---
+            if (isWrite) {
+                dirtyMask[setIndex] |= (uint64_t)1 << way;
+                MEMSIM_LOG(std::cout << "   -> " << levelName << " Write Hit! (Marked Dirty)" << std::endl);
+            }
+            return true;
+        }
+
+        // 2. MISS
+        misses++;
+        prefetchHit = false;
+        MEMSIM_EVENT(EV_MISS, source, core, address, isWrite);
+
+        // 3. Fill
+        fill(setIndex, tag, tagged, isWrite);
+        return false;
+    }
+
+    bool prefetch(uint64_t address) override {
+        uint64_t setIndex = index.set(address);
+        uint64_t tag = index.tag(address);
+        uint64_t tagged = taggedWays(setIndex, tag);
+        if (tagged & validMask[setIndex]) return false;
+
+        MEMSIM_EVENT(EV_PREFETCH, source, core, address, blockSize);
+        int way = fill(setIndex, tag, tagged, false);
+        prefetchedMask[setIndex] |= (uint64_t)1 << way;
+        return true;
+    }
+
+    CoherenceState lineState(uint64_t address) const override {
+        uint64_t setIndex = index.set(address);
+        uint64_t match = taggedWays(setIndex, index.tag(address)) & validMask[setIndex];
+        if (!match) return LINE_INVALID;
+        bool dirty = (dirtyMask[setIndex] & match) != 0;
+        bool shared = (sharedMask[setIndex] & match) != 0;
+        if (dirty) return shared ? LINE_OWNED : LINE_MODIFIED;
+        return shared ? LINE_SHARED : LINE_EXCLUSIVE;
+    }
+
+    void setLineState(uint64_t address, CoherenceState state) override {
+        uint64_t setIndex = index.set(address);
+        uint64_t match = taggedWays(setIndex, index.tag(address)) & validMask[setIndex];
+        if (!match) return;
+        if (state == LINE_INVALID) {
+            validMask[setIndex] &= ~match;
+            invalidatedMask[setIndex] |= match;
+            prefetchedMask[setIndex] &= ~match;
+        }
+        if (state == LINE_MODIFIED || state == LINE_OWNED) dirtyMask[setIndex] |= match;
+        else dirtyMask[setIndex] &= ~match;
+        if (state == LINE_SHARED || state == LINE_OWNED) sharedMask[setIndex] |= match;
+        else sharedMask[setIndex] &= ~match;
+    }
+
+    bool invalidatedLine(uint64_t address) const override {
+        uint64_t setIndex = index.set(address);
+        return (taggedWays(setIndex, index.tag(address)) & invalidatedMask[setIndex]) != 0;
+    }
+
+private:
+    static const int PaddedWays = (Ways + TAG_LANES - 1) / TAG_LANES * TAG_LANES;
+};
+
+// A level whose whole shape is known at compile time
+template <typename Policy, size_t Size, size_t BlockSize, int Assoc>
+using FixedCacheLevel = CacheEngine<Policy, FixedIndex<BlockSize, Size / (BlockSize * Assoc)>, Assoc>;
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef CACHE_POLICIES_H
+#define CACHE_POLICIES_H
+
+#include "Cache.h"
+#include "BitOps.h"
+#include <vector>
+#include <cstdint>
+
+// Replacement state for every set of one cache level. The engine fills
+// empty ways first on its own, so victim() is only asked about full sets.
+//
+//   onHit(set, way)   the line was referenced again
+//   onFill(set, way)  a new block was placed in the way
+//   victim(set)       way to evict from a full set
+
+// Per-set intrusive list of ways, most recently ordered first. Moving a
+// way to the front and reading the tail are both O(1).
+class WayList {
+private:
+    int ways;
+    std::vector<uint8_t> prev;
+    std::vector<uint8_t> next;
+    std::vector<uint8_t> head;
+    std::vector<uint8_t> tail;
+
+public:
+    WayList(size_t numSets, int w) : ways(w), prev(numSets * w), next(numSets * w), head(numSets, 0),
+                                     tail(numSets, (uint8_t)(w - 1)) {
+        for (size_t s = 0; s < numSets; s++) {
+            for (int i = 0; i < w; i++) {
+                prev[s * w + i] = (uint8_t)(i - 1);
+                next[s * w + i] = (uint8_t)(i + 1);
+            }
+        }
+    }
+
+    void moveToFront(size_t set, int way) {
+        if (head[set] == way) return;
+        uint8_t* p = &prev[set * ways];
+        uint8_t* n = &next[set * ways];
+        // Unlink (way is not the head, so it has a predecessor)
+        n[p[way]] = n[way];
+        if (tail[set] == way) tail[set] = p[way];
+        else p[n[way]] = p[way];
+        // Push at the front
+        n[way] = head[set];
+        p[head[set]] = (uint8_t)way;
+        head[set] = (uint8_t)way;
+    }
+
+    int back(size_t set) const { return tail[set]; }
+};
+
+// True LRU: recency-ordered way list
+struct LruPolicy {
+    WayList order;
+
+    LruPolicy(size_t numSets, int ways, unsigned) : order(numSets, ways) {}
+    static ReplacementPolicy kind() { return POLICY_LRU; }
+    void onHit(size_t set, int way) { order.moveToFront(set, way); }
+    void onFill(size_t set, int way) { order.moveToFront(set, way); }
+    int victim(size_t set) const { return order.back(set); }
+};
+
+// FIFO: the same list, ordered by insertion only
+struct FifoPolicy {
+    WayList order;
+
+    FifoPolicy(size_t numSets, int ways, unsigned) : order(numSets, ways) {}
+    static ReplacementPolicy kind() { return POLICY_FIFO; }
+    void onHit(size_t, int) {}
+    void onFill(size_t set, int way) { order.moveToFront(set, way); }
+    int victim(size_t set) const { return order.back(set); }
+};
+
+// Tree pseudo-LRU: ways-1 direction bits per set, stored as a heap
+// (node 1 is the root, node k has children 2k and 2k+1). A set bit sends
+// the victim search right. Needs a power-of-two associativity.
+struct PlruPolicy {
+    int levels;
+    std::vector<uint64_t> bits;
+
+    PlruPolicy(size_t numSets, int ways, unsigned) : levels(findLastSet((uint64_t)ways)), bits(numSets, 0) {}
+    static ReplacementPolicy kind() { return POLICY_PLRU; }
+
+    // Point every node on the way's path away from it
+    void touch(size_t set, int way) {
+        uint64_t& tree = bits[set];
+        int node = 1;
+        for (int l = levels - 1; l >= 0; l--) {
+            int right = (way >> l) & 1;
+            if (right) tree &= ~((uint64_t)1 << node);
+            else tree |= (uint64_t)1 << node;
+            node = 2 * node + right;
+        }
+    }
+    void onHit(size_t set, int way) { touch(set, way); }
+    void onFill(size_t set, int way) { touch(set, way); }
+    int victim(size_t set) const {
+        int node = 1;
+        for (int l = 0; l < levels; l++) node = 2 * node + (int)((bits[set] >> node) & 1);
+        return node - (1 << levels);
+    }
+};
+
+// Re-reference interval prediction (Jaleel et al.) with 2-bit RRPVs.
+// SRRIP inserts at "long" (2); BRRIP inserts at "distant" (3) and only
+// occasionally at long, which keeps scans from flushing the cache.
+template <bool Bimodal>
+struct RripPolicy {
+    static const uint8_t MAX_RRPV = 3;
+    static const unsigned BIMODAL_ODDS = 32;    // BRRIP: 1 in 32 fills go in at long
+
+    int ways;
+    std::vector<uint8_t> rrpv;
+    unsigned rng;
+
+    RripPolicy(size_t numSets, int w, unsigned seed) : ways(w), rrpv(numSets * w, MAX_RRPV), rng(seed ? seed : 1) {}
+    static ReplacementPolicy kind() { return Bimodal ? POLICY_BRRIP : POLICY_SRRIP; }
+
+    void onHit(size_t set, int way) { rrpv[set * ways + way] = 0; }
+    void onFill(size_t set, int way) {
+        uint8_t insert = MAX_RRPV - 1;
+        if (Bimodal) {
+            rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+            if (rng % BIMODAL_ODDS != 0) insert = MAX_RRPV;
+        }
+        rrpv[set * ways + way] = insert;
+    }
+    // First way predicted "distant"; if there is none, age the whole set
+    int victim(size_t set) {
+        uint8_t* r = &rrpv[set * ways];
+        uint8_t oldest = 0;
+        for (int w = 0; w < ways; w++) if (r[w] > oldest) oldest = r[w];
+        uint8_t shift = MAX_RRPV - oldest;
+        int found = -1;
+        for (int w = 0; w < ways; w++) {
+            r[w] += shift;
+            if (found < 0 && r[w] == MAX_RRPV) found = w;
+        }
+        return found;
+    }
+};
+
+template <bool Bimodal> const uint8_t RripPolicy<Bimodal>::MAX_RRPV;
+template <bool Bimodal> const unsigned RripPolicy<Bimodal>::BIMODAL_ODDS;
+
+// Not-recently-used: one reference bit per way. When the last clear bit
+// would be set, all the others are cleared.
+struct NruPolicy {
+    uint64_t allWays;
+    std::vector<uint64_t> used;
+
+    NruPolicy(size_t numSets, int ways, unsigned)
+        : allWays(ways >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << ways) - 1)), used(numSets, 0) {}
+    static ReplacementPolicy kind() { return POLICY_NRU; }
+
+    void touch(size_t set, int way) {
+        uint64_t bit = (uint64_t)1 << way;
+        used[set] |= bit;
+        if (used[set] == allWays) used[set] = bit;
+    }
+    void onHit(size_t set, int way) { touch(set, way); }
+    void onFill(size_t set, int way) { touch(set, way); }
+    int victim(size_t set) const {
+        uint64_t clear = ~used[set] & allWays;
+        return clear ? findFirstSet(clear) : 0;   // Only a 1-way set has none
+    }
+};
+
+// Uniform random victim from a seeded xorshift stream, so runs repeat
+struct RandomPolicy {
+    int ways;
+    unsigned rng;
+
+    RandomPolicy(size_t, int w, unsigned seed) : ways(w), rng(seed ? seed : 1) {}
+    static ReplacementPolicy kind() { return POLICY_RANDOM; }
+    void onHit(size_t, int) {}
+    void onFill(size_t, int) {}
+    int victim(size_t) {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        return (int)(rng % (unsigned)ways);
+    }
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef CONCURRENT_HEAP_H
+#define CONCURRENT_HEAP_H
+
+#include "MemoryManager.h"
+#include "MpscQueue.h"
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+// Drives one shared simulated heap (any MemoryManager) from several real
+// worker threads. Each worker keeps a tcache-style magazine per size class
+// and only takes the central heap lock to refill or flush a magazine.
+// Objects freed by a thread other than their owner travel back to the
+// owner through a lock-free MPSC queue.
+class ConcurrentHeap {
+private:
+    static const int NUM_CLASSES = 5;          // 16 .. 256 bytes
+    static const size_t CLASS_SIZES[NUM_CLASSES];
+    static const int MAGAZINE_SIZE = 32;
+    static const int REFILL_BATCH = MAGAZINE_SIZE / 2;
+    static const size_t LIVE_LIMIT = 1024;     // Objects a worker holds at most
+
+    struct Object {
+        int id;             // Block id in the central heap
+        int sizeClass;      // -1 for large objects (bypass the cache)
+        int owner;          // Thread whose cache the object returns to
+        Object* next;       // MPSC link
+    };
+
+    struct Worker {
+        std::vector<Object*> magazines[NUM_CLASSES];
+        std::vector<Object*> held;            // Live objects this thread uses
+        MpscQueue<Object> remoteFrees;        // Frees returning to this owner
+        MpscQueue<Object> handoff;            // Objects passed to this thread
+
+        uint64_t allocs;
+        uint64_t frees;
+        uint64_t failedAllocs;
+        uint64_t remoteFreesSent;
+        uint64_t remoteFreesReceived;
+        uint64_t cacheHits;
+        uint64_t refills;
+        uint64_t flushes;
+        uint64_t lockAcquisitions;
+        uint64_t lockContended;
+        uint64_t refillsByClass[NUM_CLASSES];
+        double seconds;
+        char padding[64];                     // Keeps neighbouring workers off this cache line
+    };
+
+    MemoryManager* central;
+    std::mutex centralLock;
+    std::vector<Worker*> workers;
+
+    long opsPerThread;
+    int remotePercent;
+    size_t liveBefore;
+    size_t liveAfter;
+
+public:
+    ConcurrentHeap(MemoryManager* heap, int threads);
+    ~ConcurrentHeap();
+
+    void run(long ops, int remotePct, unsigned seed);
+    void showStats();
+
+private:
+    void workerLoop(int tid, unsigned seed);
+    static unsigned nextRandom(unsigned& state);
+
+    Object* allocateObject(Worker& w, int tid, size_t size, int sizeClass);
+    void freeObject(Worker& w, Object* obj);
+    void drainRemoteFrees(Worker& w);
+    void releaseToCentral(Worker& w, Object** objs, size_t count);
+    void lockCentral(Worker& w);
+
+    void drainAll();
+};
+
+#endif
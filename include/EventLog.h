@@ -0,0 +1,128 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How much the simulator reports while it runs
+enum Verbosity {
+    VERBOSITY_QUIET = 0,   // Nothing on the hot path
+    VERBOSITY_EVENTS = 1,  // Structured events to the attached sink only
+    VERBOSITY_VERBOSE = 2  // Step-by-step console narration (REPL default) + events
+};
+
+enum EventType : uint8_t {
+    EV_HIT,
+    EV_MISS,
+    EV_EVICT,
+    EV_WRITEBACK,
+    EV_FAULT,
+    EV_ALLOC,
+    EV_ALLOC_FAIL,
+    EV_FREE,
+    EV_ACCESS,
+    EV_INVALIDATE,  // A core's copy of a line lost to a peer's write
+    EV_PREFETCH     // A line filled ahead of demand
+};
+
+enum EventSource : uint8_t {
+    EVSRC_L1,
+    EVSRC_L2,
+    EVSRC_L3,
+    EVSRC_CPU,   // CacheController request
+    EVSRC_VM,    // Page table / frames
+    EVSRC_HEAP,  // Allocators
+    EVSRC_DIR    // Coherence directory at the shared L3
+};
+
+// One fixed-size record; this is also the on-disk layout of binary logs
+struct Event {
+    uint8_t type;
+    uint8_t source;
+    uint16_t reserved;
+    uint32_t id;        // Block id / virtual page, 0 if unused
+    uint64_t address;   // Address, tag address or frame
+    uint64_t value;     // Size, cost in cycles, or frame
+};
+
+class EventSink {
+public:
+    virtual ~EventSink() {}
+    virtual void record(const Event& ev) = 0;
+    virtual void flush() {}
+};
+
+// "L1 HIT id=0 addr=0x40 value=0" lines through a large stdio buffer
+class TextEventSink : public EventSink {
+private:
+    FILE* out;
+    std::vector<char> buffer;
+
+public:
+    TextEventSink(FILE* f);
+    ~TextEventSink();
+    void record(const Event& ev) override;
+    void flush() override;
+};
+
+// Raw Event records behind an 8-byte "MEMSIMEV" header
+class BinaryEventSink : public EventSink {
+private:
+    FILE* out;
+    std::vector<Event> pending;
+
+public:
+    BinaryEventSink(FILE* f);
+    ~BinaryEventSink();
+    void record(const Event& ev) override;
+    void flush() override;
+};
+
+class EventLog {
+public:
+    static int verbosity;
+    static EventSink* sink;
+
+    static bool verbose() { return verbosity >= VERBOSITY_VERBOSE; }
+    static bool recording() { return sink != nullptr && verbosity >= VERBOSITY_EVENTS; }
+
+    static void emit(EventType type, EventSource source, uint32_t id, uint64_t address, uint64_t value) {
+        Event ev;
+        ev.type = type;
+        ev.source = source;
+        ev.reserved = 0;
+        ev.id = id;
+        ev.address = address;
+        ev.value = value;
+        sink->record(ev);
+    }
+
+    static bool parseVerbosity(const std::string& name, int& level);
+    static const char* verbosityName(int level);
+
+    // Opens path as a text or binary log; replaces (and flushes) any open sink
+    static bool openLog(const std::string& path, bool binary);
+    static void closeLog();
+
+    static const char* typeName(uint8_t type);
+    static const char* sourceName(uint8_t source);
+    static EventSource cacheSource(const std::string& levelName);
+};
+
+// Hot-path hooks. Building with -DMEMSIM_QUIET removes them entirely: the
+// arguments still compile (so locals only they read stay "used") but sit in
+// dead code and are never evaluated. Otherwise a quiet run pays one
+// predictable branch per call site.
+#ifdef MEMSIM_QUIET
+#define MEMSIM_LOG(stmt) do { if (false) { stmt; } } while (0)
+#define MEMSIM_EVENT(type, source, id, address, value) \
+    do { if (false) EventLog::emit(type, source, id, address, value); } while (0)
+#else
+#define MEMSIM_LOG(stmt) do { if (EventLog::verbose()) { stmt; } } while (0)
+#define MEMSIM_EVENT(type, source, id, address, value) \
+    do { if (EventLog::recording()) EventLog::emit(type, source, id, address, value); } while (0)
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef FREE_BLOCK_INDEX_H
+#define FREE_BLOCK_INDEX_H
+
+#include <list>
+#include <vector>
+#include <cstddef>
+
+struct MemoryBlock;
+
+// Address-ordered index of free blocks (a treap keyed by start address).
+// Every node also carries the largest block size in its subtree, so the
+// lowest-address block that fits a request is found in O(log n).
+class FreeBlockIndex {
+public:
+    typedef std::list<MemoryBlock>::iterator Handle;
+
+    FreeBlockIndex();
+
+    void insert(size_t address, size_t size, Handle handle);
+    void erase(size_t address);
+    void clear();
+
+    // Returns nullptr when the address is not indexed / nothing fits
+    Handle* find(size_t address);
+    Handle* firstFit(size_t request);
+
+    size_t size() const { return count; }
+
+private:
+    struct Node {
+        size_t address;
+        size_t blockSize;
+        size_t maxSize;     // Largest blockSize in this subtree
+        unsigned priority;
+        int left;
+        int right;
+        Handle handle;
+    };
+
+    std::vector<Node> nodes;     // Node pool; -1 is the null link
+    std::vector<int> freeSlots;
+    int root;
+    size_t count;
+    unsigned seed;
+
+    unsigned nextPriority();
+    void update(int n);
+    void split(int n, size_t address, int& left, int& right);
+    int merge(int left, int right);
+};
+
+#endif
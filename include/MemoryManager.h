@@ -3,8 +3,12 @@
 
 #include <vector>
 #include <list>
+#include <set>
+#include <unordered_map>
 #include <string>
 #include <iostream>
+#include "FreeBlockIndex.h"
+#include "SparseMemory.h"
 
 struct MemoryBlock {
     int id;
@@ -16,13 +20,25 @@ struct MemoryBlock {
         : id(i), startAddress(start), size(s), isFree(free) {}
 };
 
+enum FitPolicy { FIT_FIRST, FIT_BEST, FIT_WORST, FIT_NONE };
+
 class MemoryManager {
 protected:
+    typedef std::list<MemoryBlock>::iterator BlockIter;
+
     size_t totalMemorySize;
-    std::vector<char> physicalMemory; // Simulating RAM
-    std::list<MemoryBlock> memoryList; // Linked list of blocks
+    SparseMemory physicalMemory; // Simulating RAM, committed on first write
+    std::list<MemoryBlock> memoryList; // Linked list of blocks, in address order
     int nextBlockId;
     std::string allocatorType;
+    FitPolicy fitPolicy;
+
+    // Indexes over memoryList. The list nodes act as boundary tags: each
+    // block reaches both physical neighbours in O(1), so a free only has to
+    // look left and right instead of re-walking the whole heap.
+    FreeBlockIndex freeByAddress;                     // First fit
+    std::set<std::pair<size_t, size_t>> freeBySize;   // (size, address): best / worst fit
+    std::unordered_map<int, BlockIter> usedById;      // Free by id
 
     // --- NEW STATS COUNTERS ---
     size_t numAllocRequests = 0;
@@ -39,10 +55,26 @@ public:
     
     virtual bool allocate(size_t size);
     virtual bool deallocate(int blockId);
+
+    // Id handed out by the most recent successful allocate()
+    int lastBlockId() const { return nextBlockId - 1; }
+    size_t liveBlocks() const { return numSuccessfulAllocs - numFrees; }
+    const SparseMemory& memoryContents() const { return physicalMemory; }
     
     void coalesce(); // Merges adjacent free blocks
     virtual void dumpMemory(); // Visualizes memory
     virtual void showStats(); // Prints the summary
+
+protected:
+    void indexFreeBlock(BlockIter it);
+    void unindexFreeBlock(BlockIter it);
+    BlockIter findFit(size_t size);
+    BlockIter carveBlock(size_t size, int id);  // memoryList.end() if nothing fits
+    void releaseBlock(BlockIter block);
+    void coalesceAround(BlockIter it); // Merges a freed block with its neighbours
+
+    void printSummary(size_t usedMemory, size_t freeMemory, size_t usedBlocks, size_t freeBlocks,
+                      size_t internalFrag, size_t largestFreeBlock);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+
+// Lock-free multi-producer / single-consumer list of intrusive nodes.
+// Producers push with a CAS on the head; the single consumer detaches the
+// whole list with one exchange, so there is no ABA problem to guard against.
+// Nodes come back in LIFO order. T must have a `T* next` member.
+template <typename T>
+class MpscQueue {
+private:
+    std::atomic<T*> head;
+
+public:
+    MpscQueue() : head(nullptr) {}
+
+    void push(T* node) {
+        node->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(node->next, node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        }
+    }
+
+    // Consumer only: takes everything pushed so far
+    T* takeAll() {
+        if (!head.load(std::memory_order_relaxed)) return nullptr;
+        return head.exchange(nullptr, std::memory_order_acquire);
+    }
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PAGE_REPLACER_H
+#define PAGE_REPLACER_H
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum PagePolicy {
+    PAGE_FIFO,
+    PAGE_LRU,               // Exact LRU on an intrusive frame list
+    PAGE_CLOCK,             // One reference bit per frame, a hand over the frames
+    PAGE_SECOND_CHANCE,     // FIFO that requeues referenced pages once
+    PAGE_CLOCK_PRO          // Hot/cold pages with non-resident test entries (Jiang et al.)
+};
+
+// Decides which resident page a full RAM gives up. Pages are named by the
+// frame they occupy, so no operation has to search the page table; each is
+// O(1), amortised for the clock hands.
+class PageReplacer {
+protected:
+    const std::vector<uint8_t>* frame_dirty;
+    int clean_window;
+
+    // Clean-first: lets a victim search pass over up to clean_window dirty
+    // candidates, counting them in skipped, in the hope of a clean one
+    bool skip_dirty(uint64_t frame, int& skipped) const {
+        if (!frame_dirty || skipped >= clean_window || !(*frame_dirty)[frame]) return false;
+        skipped++;
+        return true;
+    }
+
+public:
+    PageReplacer() : frame_dirty(nullptr), clean_window(0) {}
+    virtual ~PageReplacer() {}
+
+    static PageReplacer* create(PagePolicy policy, uint64_t num_frames);
+    static bool parse_policy(const std::string& text, PagePolicy& policy);
+    static const char* policy_name(PagePolicy policy);
+
+    // Page page of process pid was just faulted into frame; a replacer
+    // shared by every process tells pages apart by the pair
+    virtual void on_load(uint64_t frame, uint16_t pid, uint64_t page) = 0;
+    virtual void on_access(uint64_t frame) = 0;                 // resident page referenced again
+    virtual uint64_t select_victim() = 0;                       // Only asked when every frame is in use
+
+    // Prefer clean victims, skipping at most window dirty ones per fault;
+    // frame_dirty is owned by the caller. A window of 0 turns this off.
+    void prefer_clean(const std::vector<uint8_t>* dirty, int window) {
+        frame_dirty = window > 0 ? dirty : nullptr;
+        clean_window = window;
+    }
+};
+
+#endif
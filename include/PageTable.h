@@ -0,0 +1,99 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct PageTableEntry {
+    bool valid;
+    uint64_t frame;
+};
+
+// x86-64 style radix page table with 2-4 levels. The virtual page number
+// is split into one index per level (the top level takes any remainder);
+// directory and leaf tables are only allocated when a page under them is
+// first mapped.
+//
+// Every table is given a physical address above RAM so that the entries a
+// walk reads can be replayed through the cache hierarchy.
+//
+// A directory entry may also map a huge page directly, the way x86-64 PDEs
+// and PDPTEs map 2 MiB and 1 GiB pages. A huge page of order k covers the
+// pages of k table levels (order 1 = one leaf table's span). The table it
+// replaced is kept so a split can restore it.
+class PageTable {
+private:
+    static const uint32_t NO_TABLE = 0xFFFFFFFFu;
+    static const uint32_t HUGE_ENTRY = 0x80000000u;    // Low bits index huge_pages
+
+    int levels;
+    std::vector<int> level_bits;        // Index width per level, top first
+    std::vector<int> level_shift;       // Where each index starts in the page number
+
+    // Tables are pooled; ids index into these arrays
+    std::vector<std::vector<uint32_t>> directories;     // Child table ids
+    std::vector<std::vector<PageTableEntry>> leaves;
+    std::vector<uint64_t> directory_address;
+    std::vector<uint64_t> leaf_address;
+
+    std::vector<PageTableEntry> huge_pages;
+    std::vector<uint32_t> huge_child;   // Table each huge entry replaced, or NO_TABLE
+    std::vector<uint32_t> free_huge;
+
+    uint64_t table_base;                // Physical address of the first table
+    uint64_t table_stride;              // Bytes reserved per table
+
+    uint64_t walks;
+    uint64_t walk_refs;
+    std::vector<uint64_t> last_walk;    // PTE addresses read since clear_walk_refs()
+
+    uint32_t new_directory(int level);
+    uint32_t new_leaf();
+    static bool is_huge(uint32_t entry) { return entry != NO_TABLE && (entry & HUGE_ENTRY); }
+    void unmap_huge_entry(uint32_t& entry);
+    int index_at(uint64_t page, int level) const {
+        return (int)((page >> level_shift[level]) & ((1ull << level_bits[level]) - 1));
+    }
+
+public:
+    static const int MAX_LEVEL_BITS = 16;   // Bounds a single table at 64 Ki entries
+    static const int PTE_BYTES = 8;
+
+    PageTable(int page_number_bits, int levels, uint64_t table_base);
+
+    // Hardware walk: counts one walk and appends the entries it reads to
+    // last_walk_refs(). A huge mapping ends the walk early; order (if
+    // given) receives the size order of the entry found.
+    // Returns nullptr when a table on the path or the leaf entry is absent.
+    PageTableEntry* walk(uint64_t page, int* order = nullptr);
+
+    // Same lookup without touching the walk counters (OS bookkeeping)
+    PageTableEntry* find(uint64_t page, int* order = nullptr);
+
+    // Creates any missing tables on the path and returns the leaf entry.
+    // Huge mappings met on the way are split first.
+    PageTableEntry& map(uint64_t page);
+
+    // Maps the order-k huge page holding page; any mapping below it is
+    // hidden until split_huge() restores it
+    PageTableEntry& map_huge(uint64_t page, int order);
+    void split_huge(uint64_t page, int order);
+
+    // Huge sizes this depth can express: orders 1..max_order()
+    int max_order() const { return levels - 1 < 2 ? levels - 1 : 2; }
+    int order_shift(int order) const { return level_shift[levels - 1 - order]; }
+
+    const std::vector<uint64_t>& last_walk_refs() const { return last_walk; }
+    void clear_walk_refs() { last_walk.clear(); }
+    uint64_t walk_count() const { return walks; }
+    uint64_t walk_ref_count() const { return walk_refs; }
+    int level_count() const { return levels; }
+    int bits_at(int level) const { return level_bits[level]; }
+    size_t table_pages() const { return directories.size() + leaves.size(); }
+    uint64_t table_bytes() const;
+
+    // Checks a geometry before construction; returns nullptr if usable
+    static const char* geometry_error(int page_number_bits, int levels);
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef PARALLEL_CACHE_SIM_H
+#define PARALLEL_CACHE_SIM_H
+
+#include "Cache.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+// Runs the L1 -> L2 -> L3 hierarchy on worker threads, split by set.
+//
+// With power-of-two shapes, every level's set index holds the address bits
+// just above the largest block offset. Those shard bits cut each level's
+// sets into groups no reference crosses, so shard k is a complete smaller
+// hierarchy made of the sets whose index carries k. A reference goes to
+// the shard its bits name, with the bits cut out of its address, which
+// leaves its tag and the rest of its set index as they were. Shards share
+// no state and each sees its references in trace order, so the summed
+// stats equal the serial controller's exactly.
+//
+// The caller thread only queues references; workers take one batch per
+// shard while the next one fills.
+class ParallelCacheSim {
+public:
+    // nullptr if the shapes cannot be split, with the reason in error
+    static ParallelCacheSim* create(const CacheShape shapes[3], int threads, const char*& error);
+    ~ParallelCacheSim();
+
+    void access(uint64_t address, bool isWrite, bool pageWalk) {
+        Shard& shard = shards[(address >> shardShift) & shardMask];
+        shard.filling.push_back({(address >> shardShift >> shardBits << shardShift) | (address & lowMask),
+                                 isWrite, pageWalk});
+        if (++queued == BATCH_REFS) dispatch();
+    }
+
+    // Runs every queued reference, then moves the shards' hit/miss counts
+    // into levels and their cycles into the two totals
+    void drain(CacheLevel* levels[3], unsigned long long& accessCycles, unsigned long long& walkCycles);
+
+    int shardCount() const { return (int)shards.size(); }
+    int threadCount() const { return (int)workers.size(); }
+
+private:
+    static const size_t BATCH_REFS = 1 << 16;
+
+    struct Ref {
+        uint64_t address;       // Shard bits removed
+        bool isWrite;
+        bool pageWalk;
+    };
+
+    struct Shard {
+        CacheLevel* levels[3];
+        std::vector<Ref> filling;   // Caller thread only
+        std::vector<Ref> working;   // Its worker only, between dispatch and idle
+        unsigned long long accessCycles;
+        unsigned long long walkCycles;
+    };
+
+    int shardShift;             // log2 of the largest block size
+    int shardBits;
+    uint64_t shardMask;
+    uint64_t lowMask;           // Address bits below the shard bits
+    std::vector<Shard> shards;
+    size_t queued;
+
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;   // New batch or stop, for workers
+    std::condition_variable idle;   // All workers done, for the caller
+    uint64_t generation;
+    int busy;
+    bool stopping;
+
+    ParallelCacheSim(const CacheShape shapes[3], int shift, int bits, int threads);
+
+    void dispatch();
+    void waitIdle();
+    void workerLoop(int id);
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum PrefetcherKind {
+    PREFETCH_OFF,
+    PREFETCH_NEXT_LINE,     // Tagged: the lines after each miss or first use of a prefetched line
+    PREFETCH_STRIDE,        // Per-region stride table, no PC
+    PREFETCH_STREAM,        // Stream buffers that run ahead of sequential misses
+    PREFETCH_SPATIAL        // Footprints of earlier regions, keyed by the offset that opened them
+};
+
+// What config prefetch asks of one level. degree is the lines proposed per
+// trigger; distance is how far ahead they start (next-line, stride), how
+// far a stream may run ahead of its demand (stream) or the region size in
+// lines (spatial).
+struct PrefetchConfig {
+    PrefetcherKind kind;
+    int degree;
+    int distance;
+};
+
+// Counts a level's prefetches. A prefetch is useful when demand finds the
+// line before it is evicted, and late when that happens before the fetch
+// would have completed. Evictions are valid lines a prefetch fill pushed
+// out; pollution counts the demand misses on those lines afterwards.
+struct PrefetchStats {
+    uint64_t issued;
+    uint64_t useful;
+    uint64_t late;
+    uint64_t evictions;
+    uint64_t pollution;
+};
+
+// Proposes lines for one cache level to fetch ahead of demand, and keeps
+// the bookkeeping that judges them. Lines are block numbers of the level
+// (address / block size).
+class Prefetcher {
+private:
+    struct InFlight {
+        uint64_t line;
+        uint64_t ready;         // Cycle the fetch completes
+    };
+    static const size_t IN_FLIGHT = 32;         // Fetches followed for lateness, oldest dropped
+    static const size_t DISPLACED = 4096;       // Direct-mapped filter of lines prefetches evicted
+
+    std::vector<InFlight> inFlight;
+    size_t inFlightNext;
+    std::vector<uint64_t> displaced;            // Line + 1, 0 = empty
+    PrefetchStats counts;
+
+protected:
+    PrefetchConfig config;
+
+    explicit Prefetcher(const PrefetchConfig& config);
+
+public:
+    virtual ~Prefetcher() {}
+
+    // nullptr for PREFETCH_OFF
+    static Prefetcher* create(const PrefetchConfig& config);
+    static const char* configError(const PrefetchConfig& config);
+    static bool parseKind(const std::string& text, PrefetcherKind& kind);
+    static const char* kindName(PrefetcherKind kind);
+    // The degree and distance a kind uses when config prefetch leaves them out
+    static PrefetchConfig defaults(PrefetcherKind kind);
+
+    // One demand reference the level saw: miss if it missed, prefetchHit if
+    // it hit a prefetched line for the first time. Appends the lines to
+    // fetch to out.
+    virtual void train(uint64_t line, bool miss, bool prefetchHit, std::vector<uint64_t>& out) = 0;
+
+    // A prefetch of line was filled, its data arriving at cycle ready
+    void issued(uint64_t line, uint64_t ready);
+    // Demand used a prefetched line at cycle now; returns the cycles it
+    // still waits for the fetch (late prefetch), else 0
+    uint64_t used(uint64_t line, uint64_t now);
+    // A prefetch fill evicted line
+    void displacedLine(uint64_t line);
+    // Demand missed on line; counts pollution if a prefetch evicted it
+    void demandMiss(uint64_t line);
+
+    const PrefetchConfig& getConfig() const { return config; }
+    const PrefetchStats& stats() const { return counts; }
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include "MemoryManager.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Size-class (slab) allocator. Slabs are carved from the block heap of the
+// base class; each slab holds equal-sized objects of one class and tracks
+// them with a free bitmap. Requests above the largest class go straight to
+// the block heap.
+class SlabAllocator : public MemoryManager {
+private:
+    static const size_t DEFAULT_SLAB_SIZE = 4096;
+    static const size_t MIN_CLASS_SIZE = 8;
+    static const int EMPTY_SLABS_KEPT = 1;   // Per class, beyond that empties are released
+    static const int NONE = -1;
+
+    enum SlabList { SLAB_PARTIAL, SLAB_FULL, SLAB_EMPTY, SLAB_LIST_COUNT };
+
+    struct Slab {
+        BlockIter block;              // Backing block in the heap
+        int sizeClass;
+        int objects;
+        int inUse;
+        uint64_t summary;             // Bit w set while freeMap[w] has a free object
+        std::vector<uint64_t> freeMap;
+        int list;
+        int prev;
+        int next;
+    };
+
+    struct SizeClass {
+        size_t objectSize;
+        int objectsPerSlab;
+        int heads[SLAB_LIST_COUNT];
+        size_t counts[SLAB_LIST_COUNT];
+        size_t liveObjects;
+        size_t waste;                 // objectSize - requested, summed over live objects
+        size_t slabsCreated;
+        size_t slabsReleased;
+    };
+
+    // Where an allocation id lives
+    struct ObjectRef {
+        int slab;                     // NONE for large allocations
+        int index;
+        size_t requested;
+        BlockIter block;              // Large allocations only
+    };
+
+    size_t slabSize;
+    std::vector<SizeClass> classes;
+    std::vector<Slab> slabs;
+    std::vector<int> spareSlabs;
+    std::unordered_map<size_t, int> slabAt;     // Block start -> slab, for dumpMemory
+    std::unordered_map<int, ObjectRef> objects;
+
+    size_t largeBytes;
+    size_t largeBlocks;
+    size_t reclaimedSlabs;
+
+public:
+    SlabAllocator(size_t size);
+
+    bool allocate(size_t size) override;
+    bool deallocate(int blockId) override;
+    void dumpMemory() override;
+    void showStats() override;
+
+private:
+    int classFor(size_t size) const;
+    // Start of an object and the bytes it holds (its class size, or the
+    // block of a large one)
+    size_t objectAddress(const ObjectRef& ref) const;
+    size_t objectBytes(const ObjectRef& ref) const;
+
+    int newSlab(int cls);
+    void destroySlab(int s);
+    size_t reclaimEmptySlabs();
+    BlockIter carveWithReclaim(size_t size);
+
+    void linkSlab(int s, int list);
+    void unlinkSlab(int s);
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SPARSE_MEMORY_H
+#define SPARSE_MEMORY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Simulated RAM that costs host memory only for the parts ever written.
+// The address space is split into fixed chunks that are allocated on the
+// first write to them; every other byte reads as zero. A multi-GB heap
+// therefore starts out at no host cost at all.
+class SparseMemory {
+public:
+    static const uint64_t CHUNK_SIZE = 64 * 1024;
+
+    explicit SparseMemory(uint64_t size = 0) : bytes(size) {}
+
+    uint64_t size() const { return bytes; }
+    void resize(uint64_t size);     // Chunks past the new end are dropped
+
+    // Out-of-range bytes are ignored on write and read as zero
+    void read(uint64_t address, void* out, size_t length) const;
+    void write(uint64_t address, const void* data, size_t length);
+
+    // False when no byte of the range was ever written (it is all zero)
+    bool isCommitted(uint64_t address, uint64_t length) const;
+    uint64_t committedBytes() const { return chunks.size() * CHUNK_SIZE; }
+
+private:
+    uint64_t bytes;
+    std::unordered_map<uint64_t, std::vector<char>> chunks;    // Chunk number -> contents
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Mattson stack-distance profile of a stream of keys (cache lines, pages).
+// The stack distance of a reuse is the number of distinct keys touched
+// since the previous use of the same key; a fully associative LRU store
+// of C items hits exactly the reuses at distance < C. One pass therefore
+// yields the miss ratio of every LRU size at once.
+//
+// Each key's last-use time is marked in a Fenwick tree over time, so a
+// distance is one prefix count: O(log n) per reference. The time axis is
+// renumbered when it fills up, keeping the tree within a few times the
+// number of distinct keys.
+//
+// With a sample rate below 1 only keys whose hash falls under the rate are
+// tracked (SHARDS), and their distances are scaled up by 1 / rate. The
+// curve is then an estimate, at a fraction of the time and memory.
+class StackDistance {
+public:
+    explicit StackDistance(double sampleRate = 1.0);
+
+    void access(uint64_t key);
+
+    uint64_t references() const { return totalRefs; }
+    uint64_t distinctKeys() const;          // Estimated when sampling
+    double getSampleRate() const { return sampleRate; }
+
+    // Miss ratio of a fully associative LRU store holding capacity keys
+    double missRatio(uint64_t capacity) const;
+    // Smallest capacity at which every reuse hits; the curve is flat after it
+    uint64_t flatCapacity() const;
+
+    // Rows "curve,capacity,bytes,miss_ratio,misses" for every capacity up
+    // to flatCapacity(); itemBytes is the size of one key's item
+    void writeCsv(FILE* out, const char* curve, uint64_t itemBytes) const;
+    void showStats(const std::string& title, uint64_t itemBytes) const;
+
+private:
+    static const uint64_t MIN_SPAN = 1 << 16;   // Smallest time axis
+    static const uint32_t SAMPLE_SPACE = 1 << 24;
+
+    double sampleRate;
+    uint32_t sampleThreshold;       // Keys hashing below this are tracked
+
+    std::unordered_map<uint64_t, uint64_t> lastUse;     // Key -> time of its last use
+    std::vector<uint32_t> tree;     // Fenwick tree: one mark per key, at its last use
+    uint64_t now;                   // Time of the latest tracked reference
+
+    std::vector<uint64_t> histogram;    // Tracked reuses by (unscaled) distance
+    uint64_t trackedRefs;
+    uint64_t totalRefs;
+
+    uint64_t marksUpTo(uint64_t time) const;
+    void mark(uint64_t time, int delta);
+    void renumber();
+    bool tracked(uint64_t key) const;
+};
+
+#endif
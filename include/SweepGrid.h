@@ -0,0 +1,44 @@
+#ifndef SWEEP_GRID_H
+#define SWEEP_GRID_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Configurations to sweep, read from a file of REPL commands:
+//
+//   init 65536                              every point runs this
+//   set policy {FIFO|LRU|CLOCK}             an axis of three choices
+//   config cache L2 {4096|8192} 64 {4|8}    two more axes, of two each
+//
+// Each {a|b|...} group is an axis; the grid is every combination of one
+// choice per axis. A point runs the lines in file order with its choices
+// filled in; '#' starts a comment.
+class SweepGrid {
+private:
+    struct Axis {
+        std::string name;                   // The line up to the group, e.g. "set policy"
+        std::vector<std::string> choices;
+    };
+    struct Line {
+        std::vector<std::string> text;      // Literal text around the groups
+        std::vector<size_t> axes;           // Axis of each group
+    };
+    std::vector<Line> lines;
+    std::vector<Axis> axes;
+
+public:
+    // False with a message in error if the file cannot be read, holds no
+    // command or has an unclosed or empty group
+    bool load(const std::string& path, std::string& error);
+
+    size_t pointCount() const;
+    size_t axisCount() const { return axes.size(); }
+    const std::string& axisName(size_t axis) const { return axes[axis].name; }
+
+    // The commands point index runs and its choice on each axis. The last
+    // axis varies fastest.
+    void point(size_t index, std::vector<std::string>& commands, std::vector<std::string>& labels) const;
+};
+
+#endif
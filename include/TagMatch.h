@@ -0,0 +1,63 @@
+#ifndef TAG_MATCH_H
+#define TAG_MATCH_H
+
+#include <cstdint>
+
+// Compares one tag against a run of stored tags and returns a bitmask with
+// bit w set when tags[w] == tag. `count` must be a multiple of TAG_LANES;
+// callers pad each set's tag row to that width.
+//
+// The vector path is chosen at compile time: AVX2 when the compiler targets
+// it (make NATIVE=1 on a capable host), SSE2 on any x86-64 build, and a
+// plain loop elsewhere or with make SCALAR=1 (-DMEMSIM_SCALAR_TAGS).
+
+#if !defined(MEMSIM_SCALAR_TAGS) && defined(__AVX2__)
+#include <immintrin.h>
+#define MEMSIM_TAGS_AVX2 1
+static const int TAG_LANES = 4;
+#elif !defined(MEMSIM_SCALAR_TAGS) && defined(__SSE2__)
+#include <emmintrin.h>
+#define MEMSIM_TAGS_SSE2 1
+static const int TAG_LANES = 2;
+#else
+static const int TAG_LANES = 1;
+#endif
+
+inline uint64_t matchTags(const uint64_t* tags, int count, uint64_t tag) {
+    uint64_t hits = 0;
+#if defined(MEMSIM_TAGS_AVX2)
+    __m256i needle = _mm256_set1_epi64x((long long)tag);
+    for (int w = 0; w < count; w += 4) {
+        __m256i row = _mm256_loadu_si256((const __m256i*)(tags + w));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(row, needle)));
+        hits |= (uint64_t)mask << w;
+    }
+#elif defined(MEMSIM_TAGS_SSE2)
+    // SSE2 has no 64-bit compare: both 32-bit halves must match
+    __m128i needle = _mm_set1_epi64x((long long)tag);
+    for (int w = 0; w < count; w += 2) {
+        __m128i row = _mm_loadu_si128((const __m128i*)(tags + w));
+        __m128i eq = _mm_cmpeq_epi32(row, needle);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        int mask = _mm_movemask_pd(_mm_castsi128_pd(eq));
+        hits |= (uint64_t)mask << w;
+    }
+#else
+    for (int w = 0; w < count; w++) {
+        if (tags[w] == tag) hits |= (uint64_t)1 << w;
+    }
+#endif
+    return hits;
+}
+
+inline const char* tagMatchName() {
+#if defined(MEMSIM_TAGS_AVX2)
+    return "AVX2";
+#elif defined(MEMSIM_TAGS_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+#endif
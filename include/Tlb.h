@@ -0,0 +1,64 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include "Cache.h"
+#include <cstdint>
+#include <string>
+
+// Shape of one TLB level; entries == 0 leaves the level out
+struct TlbConfig {
+    int entries;
+    int associativity;
+    ReplacementPolicy policy;
+    int latency;            // Cycles per lookup
+};
+
+// One set-associative TLB level. Entries are tagged with an address-space
+// id, so switching ASIDs needs no flush. The replacement state reuses the
+// cache policies (CachePolicies.h) through a TlbEngine specialization.
+//
+// An entry maps one page of any size order (0 = base page); a lookup
+// probes each order that has ever been filled, smallest first.
+class TlbLevel {
+public:
+    static const int MAX_ORDER = 2;
+
+protected:
+    std::string levelName;
+    int entries;
+    int associativity;
+    ReplacementPolicy policy;
+    int latency;
+    size_t numSets;
+    int orderShift[MAX_ORDER + 1];      // Page-number shift of each size order
+    bool orderUsed[MAX_ORDER + 1];
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t flushes;
+
+    TlbLevel(const std::string& name, const TlbConfig& config);
+
+public:
+    virtual ~TlbLevel() {}
+
+    // nullptr if the config holds no complete set or does not suit the policy
+    static TlbLevel* create(const std::string& name, const TlbConfig& config, unsigned seed = 1);
+    static const char* configError(const TlbConfig& config);
+
+    // Base-page counts of the huge orders, as page-number shifts
+    void setPageShifts(int hugeShift, int giantShift);
+
+    // Hit: sets the frame backing this page and the order of the entry
+    virtual bool lookup(uint16_t asid, uint64_t page, uint64_t& frame, int& order) = 0;
+    // frame backs page itself; a huge entry is stored for its whole span
+    virtual void insert(uint16_t asid, uint64_t page, uint64_t frame, int order = 0) = 0;
+    virtual void invalidate(uint16_t asid, uint64_t page) = 0;     // Every mapping covering page
+    virtual void flush() = 0;
+    virtual void flushAsid(uint16_t asid) = 0;
+
+    int getLatency() const { return latency; }
+    void showStats() const;
+};
+
+#endif
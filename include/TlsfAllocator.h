@@ -0,0 +1,71 @@
+#ifndef TLSF_ALLOCATOR_H
+#define TLSF_ALLOCATOR_H
+
+#include "MemoryManager.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Two-Level Segregated Fit: free blocks are binned by size class, first by
+// power of two (first level) and then linearly within it (second level).
+// A bitmap per level lets allocate and free find a bin with find-first-set,
+// so both run in bounded O(1) time regardless of how fragmented the heap is.
+class TlsfAllocator : public MemoryManager {
+private:
+    static const int ALIGN_LOG2 = 3;                      // 8-byte granularity
+    static const size_t ALIGN_SIZE = (size_t)1 << ALIGN_LOG2;
+    static const int SL_INDEX_LOG2 = 4;                   // 16 second-level bins
+    static const int SL_INDEX_COUNT = 1 << SL_INDEX_LOG2;
+    static const int FL_INDEX_SHIFT = SL_INDEX_LOG2 + ALIGN_LOG2;
+    static const size_t SMALL_BLOCK_SIZE = (size_t)1 << FL_INDEX_SHIFT;
+    static const size_t MIN_BLOCK_SIZE = ALIGN_SIZE;
+    static const int NONE = -1;
+
+    struct Block {
+        size_t start;
+        size_t size;
+        size_t requested;   // 0 while free
+        int id;             // 0 while free
+        bool isFree;
+        int prevPhys;       // Physical neighbours (boundary tags)
+        int nextPhys;
+        int prevFree;       // Links inside the bin's free list
+        int nextFree;
+    };
+
+    std::vector<Block> blocks;   // Block pool, addressed by index
+    std::vector<int> spareSlots;
+    int firstBlock;
+
+    int flIndexCount;
+    uint64_t flBitmap;
+    std::vector<uint32_t> slBitmap;
+    std::vector<int> freeHeads;  // flIndexCount * SL_INDEX_COUNT bins
+
+    std::unordered_map<int, int> idToBlock;
+
+    size_t usedMemory;
+    size_t usedBlocks;
+    size_t freeBlockCount;
+    size_t internalFrag;
+
+public:
+    TlsfAllocator(size_t size);
+
+    bool allocate(size_t size) override;
+    bool deallocate(int blockId) override;
+    void dumpMemory() override;
+    void showStats() override;
+
+private:
+    void mappingInsert(size_t size, int& fl, int& sl) const;
+    void mappingSearch(size_t size, int& fl, int& sl) const;
+    int findSuitableBlock(int& fl, int& sl) const;
+
+    int newBlock(size_t start, size_t size);
+    void insertFree(int b);
+    void removeFree(int b);
+    int mergeInto(int left, int right); // Absorbs right into left, returns left
+};
+
+#endif
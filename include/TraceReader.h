@@ -0,0 +1,95 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Supported on-disk trace formats
+enum TraceFormat {
+    TRACE_AUTO,     // Sniff the first meaningful line
+    TRACE_NATIVE,   // memsim commands: read/write [@core]/malloc/free/as (+ any REPL command)
+    TRACE_DINERO,   // DineroIV "din": <label> <hex addr> [size]
+    TRACE_LACKEY    // valgrind --tool=lackey --trace-mem=yes
+};
+
+enum TraceOp {
+    TRACE_READ,
+    TRACE_WRITE,
+    TRACE_MALLOC,
+    TRACE_FREE,
+    TRACE_SWITCH,   // "as <pid>": later references belong to that process
+    TRACE_COMMAND   // Any other native line, replayed through the REPL dispatcher
+};
+
+struct TraceRecord {
+    TraceOp op;
+    unsigned long long value;   // Address (read/write), size (malloc), block id (free) or pid (as)
+    int core;                   // Core of a read/write ("read <addr> @<core>"), -1 if not given
+    std::string command;        // Raw line, only filled for TRACE_COMMAND
+
+    TraceRecord() : op(TRACE_READ), value(0), core(-1) {}
+};
+
+// Streams a trace file through a large fread buffer and decodes one record
+// at a time without going through iostreams.
+class TraceReader {
+private:
+    FILE* file;
+    std::vector<char> buffer;
+    size_t pos;                 // Start of the unread part of the buffer
+    size_t len;                 // Bytes of valid data in the buffer
+    bool eof;
+
+    TraceFormat format;
+    unsigned long long lineNumber;
+    unsigned long long skippedLines;
+
+    // Lackey "M" (modify) records expand into a read followed by a write
+    bool hasPending;
+    TraceRecord pending;
+
+public:
+    TraceReader(const std::string& path, TraceFormat fmt = TRACE_AUTO);
+    ~TraceReader();
+
+    bool isOpen() const { return file != nullptr; }
+    bool next(TraceRecord& rec);
+
+    TraceFormat getFormat() const { return format; }
+    unsigned long long getSkippedLines() const { return skippedLines; }
+
+    static bool parseFormat(const std::string& name, TraceFormat& fmt);
+
+private:
+    enum ParseResult { PARSE_RECORD, PARSE_IGNORE, PARSE_ERROR };
+
+    bool nextLine(const char*& begin, const char*& end);
+    TraceFormat detect(const char* begin, const char* end) const;
+
+    ParseResult parseNative(const char* begin, const char* end, TraceRecord& rec);
+    ParseResult parseDinero(const char* begin, const char* end, TraceRecord& rec);
+    ParseResult parseLackey(const char* begin, const char* end, TraceRecord& rec);
+};
+
+// A whole trace decoded into memory, so it can be replayed many times
+// without parsing it again. Records are packed; a command's value indexes
+// commands.
+struct DecodedRecord {
+    unsigned long long value;
+    int core;
+    TraceOp op;
+};
+
+struct DecodedTrace {
+    std::vector<DecodedRecord> records;
+    std::vector<std::string> commands;
+    unsigned long long skippedLines;
+
+    DecodedTrace() : skippedLines(0) {}
+
+    // False if the file cannot be opened
+    bool load(const std::string& path, TraceFormat fmt = TRACE_AUTO);
+};
+
+#endif
@@ -1,44 +1,328 @@
 #ifndef VIRTUAL_MEMORY_H
 #define VIRTUAL_MEMORY_H
-#include <unordered_map>
 #include <vector>
-#include <queue>
+#include <deque>
 #include <string>
-struct PageTableEntry {
-    bool valid;
-    int frame;
-    int last_used;
+#include <cstdint>
+#include <unordered_map>
+#include <map>
+#include <list>
+#include <utility>
+#include "PageTable.h"
+#include "Tlb.h"
+#include "PageReplacer.h"
+#include "SparseMemory.h"
+
+// A virtual address range backed by huge pages of one size
+struct HugeRegion {
+    uint64_t start;         // Bytes
+    uint64_t length;
+    int order;              // 1 = huge (one leaf table's span, 2 MiB on x86-64), 2 = giant (1 GiB)
+    bool promote;           // Map base pages and promote a range once all of it is touched;
+                            // otherwise map the whole huge page at first touch
+};
+
+// How RAM is divided between processes under local replacement
+enum FrameAllotment {
+    ALLOT_FIXED,            // An equal share each
+    ALLOT_PFF,              // Page-fault frequency: frequent faults grow the share, rare ones shrink it
+    ALLOT_WS                // Working set: the distinct pages of the last ws_window references
+};
+
+// Pages read in along with a faulting one
+enum ReadaheadMode {
+    READAHEAD_OFF,
+    READAHEAD_FIXED,        // The next readahead_pages pages on every fault
+    READAHEAD_ADAPTIVE      // Linux-style on-demand windows that grow while a scan stays sequential
+};
+
+// Everything needed to (re)build a VirtualMemory
+struct VmConfig {
+    int va_bits;
+    int page_size;
+    uint64_t phys_mem_size;
+    std::string policy;     // FIFO, LRU, CLOCK, SECOND-CHANCE or CLOCK-PRO
+    int pt_levels;          // 2-4
+    bool walks_to_cache;    // Page-walk reads are replayed through the caches
+    TlbConfig dtlb;         // L1 data TLB; entries == 0 disables it
+    TlbConfig stlb;         // L2 shared TLB
+    int walk_latency;       // Cycles per page-table read when walks are not cached
+    int disk_read_latency;  // Cycles to page one page in from swap
+    int disk_write_latency; // Cycles to write one dirty page out to swap
+    int clean_first_window; // Dirty candidates a victim search may pass over; 0 = off
+    std::vector<HugeRegion> huge_regions;
+    bool local_replacement; // A faulting process at its allotment replaces one of its own pages
+    FrameAllotment allotment;
+    int pff_low;            // PFF: a fault within this many references of the last grows the share
+    int pff_high;           //      a fault more than this many references later shrinks it
+    int ws_window;          // WS: references in the working-set window (tau)
+    ReadaheadMode readahead;
+    int readahead_pages;    // Fixed window, or the largest adaptive one
+    int readahead_page_latency; // Cycles each extra page adds to a batched read
+    uint64_t zswap_bytes;   // Compressed pool carved out of RAM; 0 = off
+    double zswap_ratio;     // Compression ratio of a page that is not sampled
+    bool zswap_sample;      // Estimate each page's size from the heap bytes in its frame
+    int zswap_latency;      // Cycles to decompress a page on a pool hit
+    bool zswap_writeback;   // A full pool writes its oldest pages to swap; otherwise it rejects new ones
 };
 
 class VirtualMemory {
 private:
+    static const uint64_t NO_PAGE = UINT64_MAX;
+
     int virtual_address_bits;
     int page_size;
-    int physical_memory_size;
-    int num_frames;
+    int offset_bits;
+    uint64_t physical_memory_size;
+    uint64_t num_frames;
 
-    int timer;
+    // Per-frame tables only cover frames handed out so far (below
+    // fresh_frame, plus any huge block taken above it); the rest of RAM is
+    // free by definition and costs nothing until first used
+    std::vector<uint64_t> frame_owner;
+    std::vector<uint16_t> frame_pid;        // Process whose page frame_owner names
+    std::vector<uint64_t> free_frames;      // Stack of returned frames, taken before fresh ones
+    uint64_t fresh_frame;                   // Lowest frame never taken from the free pool
+    std::vector<uint8_t> frame_dirty;       // Dirty bit of the page held in each frame
 
-    std::unordered_map<int, PageTableEntry> page_table;
-    std::vector<int> frame_owner;
+    // TLBs sit in front of the page table; nullptr when not configured
+    TlbLevel* dtlb;
+    TlbLevel* stlb;
+    bool walks_to_cache;
+    int walk_latency;
+    uint64_t last_cycles;
+    int disk_read_latency;
+    int disk_write_latency;
+    uint64_t last_disk;
 
-    std::queue<int> fifo_queue;
     std::string replacement_policy;
+    PageReplacer* replacer;                 // Global replacement only
+
+    uint64_t page_hits;
+    uint64_t page_faults;
+    uint64_t disk_reads;
+    uint64_t disk_read_cycles;
+    uint64_t disk_writes;
+    uint64_t clean_evictions;
+    uint64_t dirty_evictions;
+    uint64_t address_errors;
+    uint64_t translation_cycles;
+
+    // ---------------- Huge pages ----------------
+    static const int MAX_ORDER = TlbLevel::MAX_ORDER;
+    enum FrameState { FRAME_FREE, FRAME_USED, FRAME_RESERVED };
+
+    struct PageRegion {
+        uint64_t first;         // Pages, end exclusive
+        uint64_t end;
+        int order;
+        bool promote;
+    };
+
+    // An aligned block of frames held for one huge-aligned range until all
+    // of its pages have been touched, so the range can be promoted in place
+    struct Reservation {
+        uint64_t first_frame;
+        uint64_t populated;
+        int order;
+    };
+
+    int max_order;
+    int order_bits[MAX_ORDER + 1];              // log2 of the base pages in a page of each order
+    std::vector<PageRegion> huge_regions;
+    std::vector<uint8_t> frame_state;
+    std::vector<uint8_t> frame_order;           // Size order of the mapping covering each frame
+    std::vector<uint64_t> frame_reservation;    // First page of the holding reservation, or NO_PAGE
+    bool reserve_blocks;                        // Some region promotes, so frame_reservation is kept
+    std::vector<uint64_t> block_free[MAX_ORDER + 1];    // Free frames in each aligned block
+    std::vector<uint64_t> free_blocks[MAX_ORDER + 1];   // Stack of blocks that may be wholly free
+    std::deque<std::pair<uint16_t, uint64_t> > reservation_queue;  // (pid, first page), oldest first
+
+    uint64_t hits_by_order[MAX_ORDER + 1];
+    uint64_t faults_by_order[MAX_ORDER + 1];
+    uint64_t promotions[MAX_ORDER + 1];
+    uint64_t demotions[MAX_ORDER + 1];
+    uint64_t reservations_broken;
+
+    // ---------------- Processes ----------------
+    // Each process has its own page table and resident set; its pid is the
+    // address-space id its TLB entries are tagged with
+    static const int THRASH_WINDOW = 1024;      // References per thrashing sample
+    static const int THRASH_PERCENT = 25;       // Fault rate that counts as thrashing
+    static const int PROCESS_TABLE_SHIFT = 40;  // Physical span set aside for each pid's tables
 
-    int page_hits;
-    int page_faults;
-    int disk_accesses;
+    // A page evicted into the compressed pool
+    struct CompressedPage {
+        uint16_t pid;
+        uint64_t page;
+        uint64_t bytes;
+        bool dirty;                             // Newer than its swap copy
+    };
 
-    int select_victim();
-    void handle_page_fault(int page);
+    struct Process {
+        uint16_t pid;
+        PageTable page_table;
+        PageReplacer* replacer;                 // Local replacement only
+        uint64_t resident;                      // Frames holding its pages
+        uint64_t allotment;                     // Frames it may keep under local replacement
+        uint64_t references;                    // Its own virtual time
+        uint64_t hits;
+        uint64_t faults;
+        uint64_t last_fault;                    // PFF: virtual time of the previous fault
+        std::deque<uint64_t> ws_refs;           // WS: pages of the last ws_window references
+        std::unordered_map<uint64_t, uint32_t> ws_count;
+        uint64_t window_faults;
+        uint64_t windows;
+        uint64_t thrash_windows;
+        std::unordered_map<uint64_t, Reservation> reservations;
+        std::unordered_map<uint64_t, uint64_t> range_resident;  // Resident pages per fault-mode range
+        uint64_t ra_prev;                       // Adaptive readahead: last page of the stream
+        uint64_t ra_start;                      // Current window
+        uint64_t ra_size;
+        uint64_t ra_marker;                     // Prefetched page whose first use reads the next window
+        std::unordered_map<uint64_t, std::list<CompressedPage>::iterator> compressed;  // Pages in the pool
+
+        Process(uint16_t id, int page_number_bits, int levels, uint64_t table_base)
+            : pid(id), page_table(page_number_bits, levels, table_base), replacer(nullptr),
+              resident(0), allotment(0), references(0), hits(0), faults(0), last_fault(0),
+              window_faults(0), windows(0), thrash_windows(0),
+              ra_prev(NO_PAGE), ra_start(0), ra_size(0), ra_marker(NO_PAGE) {}
+    };
+
+    int page_number_bits;
+    int pt_levels;
+    uint64_t table_base;                        // Page tables of pid 0; each pid gets its own span
+    PagePolicy page_policy;
+    int clean_first_window;
+    bool local_replacement;
+    FrameAllotment allotment;
+    int pff_low;
+    int pff_high;
+    int ws_window;
+    std::map<uint16_t, Process*> processes;
+    Process* current;
+    uint64_t context_switches;
+    uint64_t window_refs;                       // System-wide thrashing samples
+    uint64_t window_faults;
+    uint64_t windows;
+    uint64_t thrash_windows;
+
+    Process& process(uint16_t pid) { return *processes.at(pid); }
+    PageReplacer* replacer_of(const Process& p) const { return local_replacement ? p.replacer : replacer; }
+    Process& allotment_victim();
+    void share_frames(Process& newcomer);
+    void track_working_set(Process& p, uint64_t page);
+    void sample_thrashing(Process& p, bool fault);
+    void process_stats() const;
+
+    // ---------------- Readahead ----------------
+    ReadaheadMode readahead_mode;
+    uint64_t readahead_pages;
+    int readahead_page_latency;
+    std::vector<uint8_t> frame_prefetched;      // Read ahead and not used yet
+    uint64_t ra_next;                           // Batch the current translation asked for
+    uint64_t ra_count;
+    bool ra_async;
+    uint64_t ra_batches;
+    uint64_t ra_async_batches;
+    uint64_t ra_pages;
+    uint64_t ra_used;
+    uint64_t ra_wasted;
+    uint64_t ra_overlapped_cycles;
+
+    uint64_t next_window(uint64_t size) const;
+    void plan_readahead(Process& p, uint64_t page);
+    void use_prefetched(Process& p, uint64_t page, uint64_t frame);
+    void readahead(Process& p, uint64_t in_use);
+
+    // ---------------- Compressed pool ----------------
+    // Evicted pages are compressed into a pool carved out of RAM, so a
+    // later fault costs a decompression instead of a disk read. The pool
+    // keeps its own LRU; when full it writes back the oldest page (a disk
+    // write only if that page is dirty) or turns new pages away to swap.
+    uint64_t zswap_capacity;
+    double zswap_ratio;
+    bool zswap_sample;
+    int zswap_latency;
+    bool zswap_writeback;
+    const SparseMemory* memory;                 // Heap bytes behind the frames, for sampling
+    std::list<CompressedPage> pool;             // Least recently stored first
+    uint64_t pool_bytes;
+    uint64_t zswap_stores;
+    uint64_t zswap_same_filled;
+    uint64_t zswap_hits;
+    uint64_t zswap_writebacks;
+    uint64_t zswap_rejects;
+
+    uint64_t compressed_size(uint64_t frame) const;
+    bool compress(Process& p, uint64_t page, uint64_t frame, bool dirty);
+    bool decompress(Process& p, uint64_t page, bool& dirty);
+    void write_back_oldest();
+
+    uint64_t order_pages(int order) const { return (uint64_t)1 << order_bits[order]; }
+    const PageRegion* region_of(uint64_t page) const;
+    bool range_in(const PageRegion& region, uint64_t first) const {
+        return first >= region.first && first + order_pages(region.order) <= region.end;
+    }
+
+    void grow_frames(uint64_t end);             // Extends the per-frame tables to cover frames below end
+    void set_frame_state(uint64_t frame, FrameState state);
+    bool take_free_frame(uint64_t& frame);
+    bool take_free_block(int order, uint64_t& first_frame);
+    uint64_t take_frame(Process& p, uint64_t keep = NO_PAGE);  // Free frame, broken reservation or evicting any but keep
+    void evict_frame(uint64_t frame);
+    void load(Process& p, uint64_t frame, uint64_t page);
+    void count_resident(Process& p, uint64_t page, int delta);
+
+    uint64_t reserved_frame(Process& p, uint64_t page, const PageRegion& region);
+    bool fault_huge(Process& p, uint64_t page, const PageRegion& region);
+    void break_reservation(Process& p, uint64_t first_page);
+    void promote(Process& p, uint64_t first_page);
+    void demote(Process& p, uint64_t page, int order);
+
+    bool handle_page_fault(uint64_t page);     // False when no frame can be freed for it
 
 public:
-    VirtualMemory(int va_bits,
-                  int page_size,
-                  int phys_mem_size,
-                  const std::string& policy);
+    VirtualMemory(const VmConfig& config);
+    ~VirtualMemory();
+
+    // Checks a configuration before construction; returns nullptr if usable
+    static const char* config_error(const VmConfig& config);
+    static const char* allotment_name(FrameAllotment allotment);
+
+    // False if the address lies outside the virtual address space, or no
+    // frame can be freed for its page. A write marks the page dirty, so
+    // evicting it later costs a swap-out.
+    bool translate(uint64_t virtual_address, uint64_t& physical_address, bool is_write = false);
+
+    // Page-table entries read by the latest translation (a fault walks
+    // twice), for the caches
+    const std::vector<uint64_t>& last_walk_refs() const { return current->page_table.last_walk_refs(); }
+
+    // Cycles the latest translation spent in the TLBs, plus the walk when
+    // walks are not sent to the caches. Only meaningful when
+    // models_translation() is true; otherwise translation is free as before.
+    uint64_t last_translation_cycles() const { return last_cycles; }
+    bool models_translation() const { return dtlb || stlb || walks_to_cache; }
+
+    // Swap traffic the latest translation caused: a page-in and, if the
+    // victim was dirty, a write-back
+    uint64_t last_disk_cycles() const { return last_disk; }
+
+    // Later references belong to process pid, which is created on first
+    // use. TLB entries are tagged with the pid, so a switch needs no flush.
+    void switch_process(uint16_t pid);
+    uint16_t asid() const { return current->pid; }
+    size_t process_count() const { return processes.size(); }
+    void flush_tlb();
+    void flush_tlb(uint16_t asid);
+
+    uint64_t fault_count() const { return page_faults; }
+    uint64_t address_error_count() const { return address_errors; }
+    uint64_t reference_count() const { return page_hits + page_faults; }
 
-    int translate(int virtual_address);
+    // Bytes the compressed pool may sample; nullptr falls back to the fixed ratio
+    void sample_memory(const SparseMemory* contents) { memory = contents; }
 
     void stats() const;
 };
@@ -0,0 +1,204 @@
+#include "../include/ArenaAllocator.h"
+#include "../include/EventLog.h"
+#include <iostream>
+
+const size_t ArenaAllocator::DEFAULT_CHUNK_SIZE;
+const size_t ArenaAllocator::ALIGN_SIZE;
+
+ArenaAllocator::ArenaAllocator(size_t size)
+    : MemoryManager(size), liveBytes(0), paddingBytes(0), resets(0), resetObjects(0), chunksCreated(0) {
+    this->allocatorType = "arena";
+
+    // Small heaps get smaller chunks so that there is room for several
+    chunkSize = DEFAULT_CHUNK_SIZE;
+    while (chunkSize > 64 && chunkSize * 16 > size) chunkSize /= 2;
+
+    Mark root = { 0, 0, 0 };
+    arenas.push_back(root);
+
+    MEMSIM_LOG(std::cout << "[Arena] Initialized. Size: " << totalMemorySize << " bytes, chunk "
+              << chunkSize << " bytes" << std::endl);
+}
+
+// ---------------- Chunks ----------------
+
+// Oversized requests get a chunk of their own size
+bool ArenaAllocator::newChunk(size_t minSize) {
+    size_t size = minSize > chunkSize ? minSize : chunkSize;
+    BlockIter block = carveBlock(size, 0);
+    if (block == memoryList.end()) return false;
+
+    Chunk chunk;
+    chunk.block = block;
+    chunk.size = size;
+    chunk.used = 0;
+    chunk.live = 0;
+    chunks.push_back(chunk);
+    chunksCreated++;
+    return true;
+}
+
+// Every chunk but the last one is closed: its unused tail can never be handed out
+size_t ArenaAllocator::tailWaste() const {
+    size_t waste = 0;
+    for (size_t c = 0; c + 1 < chunks.size(); c++) waste += chunks[c].size - chunks[c].used;
+    return waste;
+}
+
+void ArenaAllocator::forgetObject(std::unordered_map<int, ObjectRef>::iterator it) {
+    const ObjectRef& ref = it->second;
+    chunks[ref.chunk].live -= ref.size;
+    liveBytes -= ref.size;
+    paddingBytes -= ref.size - ref.requested;
+    objects.erase(it);
+}
+
+// ---------------- Allocator interface ----------------
+
+bool ArenaAllocator::allocate(size_t size) {
+    numAllocRequests++;
+
+    size_t aligned = (size + ALIGN_SIZE - 1) & ~(ALIGN_SIZE - 1);
+    if (aligned == 0) aligned = ALIGN_SIZE;
+
+    bool fits = !chunks.empty() && chunks.back().size - chunks.back().used >= aligned;
+    if (!fits && (size > totalMemorySize || !newChunk(aligned))) {
+        MEMSIM_LOG(std::cout << "Error: Not enough memory to allocate " << size << " bytes." << std::endl);
+        MEMSIM_EVENT(EV_ALLOC_FAIL, EVSRC_HEAP, 0, 0, size);
+        numFailedAllocs++;
+        return false;
+    }
+
+    Chunk& chunk = chunks.back();
+    ObjectRef ref;
+    ref.chunk = chunks.size() - 1;
+    ref.offset = chunk.used;
+    ref.size = aligned;
+    ref.requested = size;
+    ref.depth = depth();
+
+    chunk.used += aligned;
+    chunk.live += aligned;
+    liveBytes += aligned;
+    paddingBytes += aligned - size;
+
+    int id = nextBlockId++;
+    objects[id] = ref;
+    allocationLog.push_back(id);
+
+    size_t address = chunk.block->startAddress + ref.offset;
+    MEMSIM_LOG(std::cout << "Allocated block id=" << id << " at address=0x" << std::hex << address << std::dec
+              << " (arena " << ref.depth << ")" << std::endl);
+    MEMSIM_EVENT(EV_ALLOC, EVSRC_HEAP, id, address, aligned);
+
+    numSuccessfulAllocs++;
+    return true;
+}
+
+// Individual frees only give memory back when they undo the most recent
+// allocation of the current arena; anything else stays dead until reset.
+bool ArenaAllocator::deallocate(int blockId) {
+    auto found = objects.find(blockId);
+    if (found == objects.end()) {
+        MEMSIM_LOG(std::cout << "Error: Block ID " << blockId << " not found." << std::endl);
+        return false;
+    }
+
+    const ObjectRef& ref = found->second;
+    Chunk& chunk = chunks[ref.chunk];
+    MEMSIM_EVENT(EV_FREE, EVSRC_HEAP, blockId, chunk.block->startAddress + ref.offset, ref.size);
+
+    if (ref.chunk == chunks.size() - 1 && ref.depth == depth() && ref.offset + ref.size == chunk.used) {
+        chunk.used = ref.offset;
+    }
+    forgetObject(found);
+
+    MEMSIM_LOG(std::cout << "Block " << blockId << " freed." << std::endl);
+    numFrees++;
+    return true;
+}
+
+// ---------------- Arena stack ----------------
+
+void ArenaAllocator::beginArena() {
+    Mark mark;
+    mark.chunkCount = chunks.size();
+    mark.used = chunks.empty() ? 0 : chunks.back().used;
+    mark.logSize = allocationLog.size();
+    arenas.push_back(mark);
+    MEMSIM_LOG(std::cout << "[Arena] Begin arena " << depth() << std::endl);
+}
+
+// Frees everything allocated since the innermost arena began and closes
+// it. Resetting the outermost arena empties the heap but keeps it open.
+void ArenaAllocator::resetArena() {
+    Mark mark = arenas.back();
+
+    size_t released = 0;
+    for (size_t i = mark.logSize; i < allocationLog.size(); i++) {
+        auto it = objects.find(allocationLog[i]);
+        if (it == objects.end()) continue;   // Already freed individually
+        forgetObject(it);
+        released++;
+    }
+    allocationLog.resize(mark.logSize);
+
+    size_t releasedChunks = 0;
+    while (chunks.size() > mark.chunkCount) {
+        releaseBlock(chunks.back().block);
+        chunks.pop_back();
+        releasedChunks++;
+    }
+    if (!chunks.empty()) chunks.back().used = mark.used;
+
+    MEMSIM_LOG(std::cout << "[Arena] Reset arena " << depth() << ": released " << released
+              << " object(s), " << releasedChunks << " chunk(s)" << std::endl);
+    if (arenas.size() > 1) arenas.pop_back();
+
+    numFrees += released;
+    resets++;
+    resetObjects += released;
+}
+
+void ArenaAllocator::dumpMemory() {
+    std::unordered_map<size_t, size_t> chunkAt;
+    for (size_t c = 0; c < chunks.size(); c++) chunkAt[chunks[c].block->startAddress] = c;
+
+    std::cout << "\n--- Memory Dump (Arena) ---" << std::endl;
+    for (const auto& block : memoryList) {
+        std::cout << "[0x" << std::hex << block.startAddress << "-0x"
+                  << (block.startAddress + block.size - 1) << std::dec << "] ";
+        if (block.isFree) {
+            std::cout << "FREE (" << block.size << " bytes)" << std::endl;
+            continue;
+        }
+        const Chunk& chunk = chunks[chunkAt[block.startAddress]];
+        std::cout << "CHUNK (" << chunk.used << "/" << chunk.size << " bytes bumped, "
+                  << chunk.live << " live)" << std::endl;
+    }
+    std::cout << "Arena depth: " << depth() << std::endl;
+    std::cout << "---------------------------\n" << std::endl;
+}
+
+void ArenaAllocator::showStats() {
+    // Freed objects below the bump pointer stay dead until their arena is reset
+    size_t deadBytes = 0;
+    size_t largestFreeBlock = freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+    for (const auto& chunk : chunks) deadBytes += chunk.used - chunk.live;
+    if (!chunks.empty() && chunks.back().size - chunks.back().used > largestFreeBlock) {
+        largestFreeBlock = chunks.back().size - chunks.back().used;
+    }
+
+    printSummary(liveBytes, totalMemorySize - liveBytes, objects.size(), freeBySize.size(),
+                 paddingBytes + deadBytes, largestFreeBlock);
+
+    size_t chunkBytes = 0;
+    for (const auto& chunk : chunks) chunkBytes += chunk.size;
+    std::cout << "Chunk tail waste       : " << tailWaste() << " bytes" << std::endl;
+    std::cout << "Dead (freed) bytes     : " << deadBytes << " bytes" << std::endl;
+    std::cout << "Arena depth            : " << depth() << std::endl;
+    std::cout << "Chunks                 : " << chunks.size() << " (" << chunkBytes << " bytes, "
+              << chunksCreated << " created, chunk size " << chunkSize << ")" << std::endl;
+    std::cout << "Resets                 : " << resets << " (" << resetObjects << " objects released)" << std::endl;
+    std::cout << "---------------------------" << std::endl;
+}
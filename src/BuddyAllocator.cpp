@@ -1,212 +1,220 @@
 #include "../include/BuddyAllocator.h"
+#include "../include/EventLog.h"
 #include <iostream>
 #include <algorithm>
-#include <cmath>
 #include <vector>
-#include <iomanip> 
+#include <iomanip>
+
+const uint32_t BuddyAllocator::NIL;
+const uint8_t BuddyAllocator::NO_BLOCK;
+const int BuddyAllocator::MAX_TRACKED_BITS;
 
 BuddyAllocator::BuddyAllocator(size_t size) : MemoryManager(size) {
     this->allocatorType = "buddy";
     size_t powerOf2Size = 1;
-    while (powerOf2Size < size) powerOf2Size *= 2;
-    
+    maxOrder = 0;
+    while (powerOf2Size < size) {
+        powerOf2Size *= 2;
+        maxOrder++;
+    }
+
     if (powerOf2Size != size) {
         totalMemorySize = powerOf2Size;
         physicalMemory.resize(totalMemorySize);
     }
-    minBlockSize = 1; 
-    maxOrder = (int)std::log2(totalMemorySize);
-    freeLists.resize(maxOrder + 1);
+    minOrder = std::max(0, maxOrder - MAX_TRACKED_BITS);
+    minBlockSize = blockBytes(minOrder);
     initializeBuddy();
 }
 
 void BuddyAllocator::initializeBuddy() {
-    freeLists[maxOrder].push_back(MemoryBlock(0, 0, totalMemorySize, true));
-    std::cout << "[Buddy] Initialized. Size: " << totalMemorySize << " bytes" << std::endl;
+    size_t numMinBlocks = totalMemorySize >> minOrder;
+
+    freeBitmap.assign(maxOrder + 1, std::vector<uint64_t>());
+    for (int k = minOrder; k <= maxOrder; k++) {
+        size_t blocks = numMinBlocks >> (k - minOrder);
+        freeBitmap[k].assign((blocks + 63) / 64, 0);
+    }
+    freeHead.assign(maxOrder + 1, NIL);
+    freeTail.assign(maxOrder + 1, NIL);
+    freeCount.assign(maxOrder + 1, 0);
+    nextFree.assign(numMinBlocks, NIL);
+    prevFree.assign(numMinBlocks, NIL);
+
+    blockOrder.assign(numMinBlocks, NO_BLOCK);
+    blockId.assign(numMinBlocks, 0);
+    requestedSize.assign(numMinBlocks, 0);
+
+    usedMemory = 0;
+    usedBlocks = 0;
+    internalFrag = 0;
+
+    pushFree(maxOrder, 0);
+    MEMSIM_LOG(std::cout << "[Buddy] Initialized. Size: " << totalMemorySize << " bytes" << std::endl);
 }
 
 int BuddyAllocator::getOrder(size_t size) {
-    size_t actualSize = std::max(size, minBlockSize);
-    return std::ceil(std::log2(actualSize));
+    if (size > totalMemorySize) return maxOrder + 1;
+    int order = minOrder;
+    while (blockBytes(order) < size) order++;
+    return order;
+}
+
+// ---------------- Free list / bitmap primitives ----------------
+
+bool BuddyAllocator::isFree(int order, uint32_t index) const {
+    size_t bit = index >> (order - minOrder);
+    return (freeBitmap[order][bit >> 6] >> (bit & 63)) & 1;
+}
+
+void BuddyAllocator::pushFree(int order, uint32_t index) {
+    size_t bit = index >> (order - minOrder);
+    freeBitmap[order][bit >> 6] |= (uint64_t)1 << (bit & 63);
+
+    nextFree[index] = NIL;
+    prevFree[index] = freeTail[order];
+    if (freeTail[order] != NIL) nextFree[freeTail[order]] = index;
+    else freeHead[order] = index;
+    freeTail[order] = index;
+    freeCount[order]++;
+}
+
+void BuddyAllocator::removeFree(int order, uint32_t index) {
+    size_t bit = index >> (order - minOrder);
+    freeBitmap[order][bit >> 6] &= ~((uint64_t)1 << (bit & 63));
+
+    if (prevFree[index] != NIL) nextFree[prevFree[index]] = nextFree[index];
+    else freeHead[order] = nextFree[index];
+    if (nextFree[index] != NIL) prevFree[nextFree[index]] = prevFree[index];
+    else freeTail[order] = prevFree[index];
+    freeCount[order]--;
 }
 
+uint32_t BuddyAllocator::popFree(int order) {
+    uint32_t index = freeHead[order];
+    removeFree(order, index);
+    return index;
+}
+
+// ---------------- Allocator interface ----------------
+
 bool BuddyAllocator::allocate(size_t size) {
     numAllocRequests++; // <--- NEW
 
     int reqOrder = getOrder(size);
     int currentOrder = reqOrder;
-    while (currentOrder <= maxOrder && freeLists[currentOrder].empty()) {
+    while (currentOrder <= maxOrder && freeHead[currentOrder] == NIL) {
         currentOrder++;
     }
 
     if (currentOrder > maxOrder) {
-        std::cout << "[Buddy] Allocation Failed: Out of Memory" << std::endl;
+        MEMSIM_LOG(std::cout << "[Buddy] Allocation Failed: Out of Memory" << std::endl);
+        MEMSIM_EVENT(EV_ALLOC_FAIL, EVSRC_HEAP, 0, 0, size);
         numFailedAllocs++; // <--- NEW
         return false;
     }
 
+    // Split down to the requested order; both halves join the lower list
     while (currentOrder > reqOrder) {
-        MemoryBlock block = freeLists[currentOrder].front();
-        freeLists[currentOrder].pop_front();
-        currentOrder--; 
-
-        size_t buddySize = block.size / 2;
-        MemoryBlock left(0, block.startAddress, buddySize, true);
-        MemoryBlock right(0, block.startAddress + buddySize, buddySize, true);
-
-        freeLists[currentOrder].push_back(left);
-        freeLists[currentOrder].push_back(right);
+        uint32_t index = popFree(currentOrder);
+        currentOrder--;
+        pushFree(currentOrder, index);
+        pushFree(currentOrder, index + blockSpan(currentOrder));
     }
 
-    MemoryBlock& allocated = freeLists[reqOrder].front();
-    allocated.isFree = false;
-    allocated.id = nextBlockId++;
+    uint32_t index = popFree(reqOrder);
+    int id = nextBlockId++;
+    size_t allocatedSize = blockBytes(reqOrder);
+
+    blockOrder[index] = (uint8_t)reqOrder;
+    blockId[index] = id;
+    requestedSize[index] = size;
+    idToIndex[id] = index;
 
-    allocatedBlockMap[allocated.startAddress] = reqOrder;
-    idToAddressMap[allocated.id] = allocated.startAddress;
-    requestedSizeMap[allocated.id] = size; 
+    usedMemory += allocatedSize;
+    usedBlocks++;
+    internalFrag += allocatedSize - size;
 
-    std::cout << "Allocated ID " << allocated.id << " @ 0x" << std::hex << allocated.startAddress 
-              << std::dec << " (" << allocated.size << " bytes)" << std::endl;
+    MEMSIM_LOG(std::cout << "Allocated ID " << id << " @ 0x" << std::hex << blockAddress(index)
+              << std::dec << " (" << allocatedSize << " bytes)" << std::endl);
+    MEMSIM_EVENT(EV_ALLOC, EVSRC_HEAP, id, blockAddress(index), allocatedSize);
 
-    freeLists[reqOrder].pop_front();
-    
     numSuccessfulAllocs++; // <--- NEW
     return true;
 }
 
 bool BuddyAllocator::deallocate(int blockId) {
-    if (idToAddressMap.find(blockId) == idToAddressMap.end()) {
-        std::cout << "Error: Invalid Block ID " << blockId << std::endl;
+    auto found = idToIndex.find(blockId);
+    if (found == idToIndex.end()) {
+        MEMSIM_LOG(std::cout << "Error: Invalid Block ID " << blockId << std::endl);
         return false;
     }
 
-    size_t address = idToAddressMap[blockId];
-    int order = allocatedBlockMap[address];
+    uint32_t index = found->second;
+    int order = blockOrder[index];
+    idToIndex.erase(found);
 
-    idToAddressMap.erase(blockId);
-    allocatedBlockMap.erase(address);
-    requestedSizeMap.erase(blockId); 
+    usedMemory -= blockBytes(order);
+    usedBlocks--;
+    internalFrag -= blockBytes(order) - requestedSize[index];
+    blockOrder[index] = NO_BLOCK;
+    this->blockId[index] = 0;
+    requestedSize[index] = 0;
 
-    std::cout << "Freeing ID " << blockId << std::endl;
+    MEMSIM_LOG(std::cout << "Freeing ID " << blockId << std::endl);
+    MEMSIM_EVENT(EV_FREE, EVSRC_HEAP, blockId, blockAddress(index), blockBytes(order));
     numFrees++; // <--- NEW
 
-    size_t currentAddr = address;
-    size_t currentSize = (1 << order);
-
+    // Merge upwards while the buddy is free
     while (order < maxOrder) {
-        size_t buddyAddr = currentAddr ^ currentSize; 
-        bool buddyIsFree = false;
-        auto& list = freeLists[order];
-        
-        for (auto it = list.begin(); it != list.end(); ++it) {
-            if (it->startAddress == buddyAddr && it->isFree) {
-                buddyIsFree = true;
-                list.erase(it);
-                currentAddr = std::min(currentAddr, buddyAddr);
-                currentSize *= 2;
-                order++;
-                break;
-            }
-        }
-        if (!buddyIsFree) break;
+        uint32_t buddy = index ^ blockSpan(order);
+        if (!isFree(order, buddy)) break;
+        removeFree(order, buddy);
+        index = std::min(index, buddy);
+        order++;
     }
 
-    freeLists[order].push_back(MemoryBlock(0, currentAddr, currentSize, true));
+    pushFree(order, index);
     return true;
 }
+
 void BuddyAllocator::dumpMemory() {
-    struct BlockInfo {
-        size_t start;
-        size_t size;
-        bool isFree;
-        int id; 
-    };
-    std::vector<BlockInfo> allBlocks;
-
-    // 1. Gather Used Blocks
-    for (auto const& [addr, order] : allocatedBlockMap) {
-        int id = 0;
-        // Find ID associated with this address
-        for(auto const& [bid, baddr] : idToAddressMap) {
-            if(baddr == addr) { id = bid; break; }
-        }
-        allBlocks.push_back({addr, (size_t)1 << order, false, id});
-    }
+    std::cout << "\n--- Memory Map (Buddy) ---\n";
 
-    // 2. Gather Free Blocks from all lists
-    for (const auto& list : freeLists) {
-        for (const auto& block : list) {
-            allBlocks.push_back({block.startAddress, block.size, true, 0});
+    // Walk the heap in address order; each step covers one whole block
+    uint32_t numMinBlocks = (uint32_t)(totalMemorySize >> minOrder);
+    uint32_t index = 0;
+    while (index < numMinBlocks) {
+        size_t start = blockAddress(index);
+        int order = blockOrder[index];
+        bool free = (order == NO_BLOCK);
+        if (free) {
+            for (order = maxOrder; order > minOrder; order--) {
+                if ((index & (blockSpan(order) - 1)) == 0 && isFree(order, index)) break;
+            }
         }
-    }
-
-    // 3. Sort by Address to show linear memory layout
-    std::sort(allBlocks.begin(), allBlocks.end(), [](const BlockInfo& a, const BlockInfo& b) {
-        return a.start < b.start;
-    });
+        size_t size = blockBytes(order);
 
-    std::cout << "\n--- Memory Map (Buddy) ---\n";
-    for (const auto& b : allBlocks) {
-        std::cout << "[0x" << std::hex << b.start << " - 0x" << (b.start + b.size - 1) << "] " << std::dec;
-        if (b.isFree) {
-            std::cout << "FREE (" << b.size << " bytes)" << std::endl;
+        std::cout << "[0x" << std::hex << start << " - 0x" << (start + size - 1) << "] " << std::dec;
+        if (free) {
+            std::cout << "FREE (" << size << " bytes)" << std::endl;
         } else {
-            std::cout << "USED (ID " << b.id << ", " << b.size << " bytes)" << std::endl;
+            std::cout << "USED (ID " << blockId[index] << ", " << size << " bytes)" << std::endl;
         }
+        index += blockSpan(order);
     }
     std::cout << "--------------------------\n";
 }
 // >>> UPDATED FOR BUDDY STATS <<<
 void BuddyAllocator::showStats() {
-    size_t usedMemory = 0; 
-    size_t internalFrag = 0;
-    size_t usedBlocks = 0;
-    
-    // Calculate Used Stats
-    for (auto const& [id, reqSize] : requestedSizeMap) {
-        size_t address = idToAddressMap[id];
-        int order = allocatedBlockMap[address];
-        size_t allocatedSize = (1 << order);
-        
-        usedMemory += allocatedSize;
-        internalFrag += (allocatedSize - reqSize);
-        usedBlocks++;
-    }
-
     size_t freeMemory = totalMemorySize - usedMemory;
     size_t freeBlocks = 0;
     size_t largestFreeBlock = 0;
-    
-    for (const auto& list : freeLists) {
-        freeBlocks += list.size();
-        if (!list.empty()) {
-            size_t blockSize = list.front().size;
-            if (blockSize > largestFreeBlock) largestFreeBlock = blockSize;
-        }
-    }
 
-    double utilPercent = (totalMemorySize > 0) ? ((double)usedMemory / totalMemorySize) * 100.0 : 0.0;
-    double successRate = (numAllocRequests > 0) ? ((double)numSuccessfulAllocs / numAllocRequests) * 100.0 : 0.0;
-    
-    double extFrag = 0.0;
-    if (freeMemory > 0) {
-        extFrag = 1.0 - ((double)largestFreeBlock / freeMemory);
+    for (int k = minOrder; k <= maxOrder; k++) {
+        freeBlocks += freeCount[k];
+        if (freeCount[k] > 0) largestFreeBlock = blockBytes(k);
     }
 
-    std::cout << "\n--------- SUMMARY ---------" << std::endl;
-    std::cout << "Total heap size        : " << totalMemorySize << " bytes" << std::endl;
-    std::cout << "Used memory            : " << usedMemory << " bytes" << std::endl;
-    std::cout << "Free memory            : " << freeMemory << " bytes" << std::endl;
-    std::cout << "Used blocks            : " << usedBlocks << std::endl;
-    std::cout << "Free blocks            : " << freeBlocks << std::endl;
-    std::cout << "Internal fragmentation : " << internalFrag << " bytes" << std::endl;
-    std::cout << "Memory utilization     : " << std::fixed << std::setprecision(2) << utilPercent << "%" << std::endl;
-    std::cout << "External fragmentation : " << std::fixed << std::setprecision(3) << extFrag << std::endl;
-    std::cout << "Allocation requests    : " << numAllocRequests << std::endl;
-    std::cout << "Successful allocs      : " << numSuccessfulAllocs << std::endl;
-    std::cout << "Failed allocs          : " << numFailedAllocs << std::endl;
-    std::cout << "Frees                  : " << numFrees << std::endl;
-    std::cout << "Success rate           : " << std::fixed << std::setprecision(2) << successRate << "%" << std::endl;
-    std::cout << "---------------------------" << std::endl;
-}
\ No newline at end of file
+    printSummary(usedMemory, freeMemory, usedBlocks, freeBlocks, internalFrag, largestFreeBlock);
+}
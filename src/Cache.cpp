@@ -1,110 +1,94 @@
 #include "../include/Cache.h"
+#include "../include/CacheEngine.h"
+#include "../include/ParallelCacheSim.h"
+#include <cctype>
+
+const int CacheLevel::MAX_WAYS;
 
 // ================= CacheLevel Implementation =================
 
-CacheLevel::CacheLevel(std::string name, size_t size, size_t blkSize, int assoc, std::string pol)
-    : levelName(name), cacheSize(size), blockSize(blkSize), associativity(assoc), policy(pol) {
+CacheLevel::CacheLevel(std::string name, size_t size, size_t blkSize, int assoc, ReplacementPolicy pol)
+    : levelName(name), cacheSize(size), blockSize(blkSize), associativity(assoc), policy(pol),
+      source(EventLog::cacheSource(name)), core(0) {
     
     // Calculate number of sets
     numSets = cacheSize / (blockSize * associativity);
-    
-    sets.resize(numSets);
-    for (auto& set : sets) {
-        set.lines.resize(associativity); 
-    }
 
     hits = 0;
     misses = 0;
-    globalTime = 0;
-    
-    std::cout << "[" << levelName << "] Initialized: " << size << " bytes, " 
-              << numSets << " sets, " << associativity << "-way, " << policy << "." << std::endl;
+    victimValid = false;
+    victimAddress = 0;
+    prefetchHit = false;
 }
 
-bool CacheLevel::access(unsigned long address, bool isWrite) {
-    globalTime++; 
-    
-    unsigned long setIndex = (address / blockSize) % numSets;
-    unsigned long tag = address / (blockSize * numSets);
-
-    // 1. Check for HIT
-    for (auto& line : sets[setIndex].lines) {
-        if (line.valid && line.tag == tag) {
-            hits++;
-            if (policy == "LRU") line.lruTime = globalTime;
-            
-            // --- WRITE POLICY (Write-Back) ---
-            if (isWrite) {
-                line.dirty = true;
-                std::cout << "   -> " << levelName << " Write Hit! (Marked Dirty)" << std::endl;
-            }
-            // ---------------------------------
-            return true; 
-        }
-    }
+static const char* const POLICY_NAMES[] = { "LRU", "FIFO", "PLRU", "SRRIP", "BRRIP", "NRU", "RANDOM" };
 
-    // 2. MISS
-    misses++;
-    handleReplacement(setIndex, tag);
-    
-    // 3. Write-Allocate (If we wrote, we must mark the newly loaded block as dirty)
-    if (isWrite) {
-        // Find the block we just inserted
-        for (auto& line : sets[setIndex].lines) {
-            if (line.valid && line.tag == tag) {
-                line.dirty = true;
-                break;
-            }
+bool CacheLevel::parsePolicy(const std::string& text, ReplacementPolicy& pol) {
+    std::string upper = text;
+    for (auto& c : upper) c = (char)toupper((unsigned char)c);
+    if (upper == "TREE-PLRU") upper = "PLRU";
+
+    for (int p = POLICY_LRU; p <= POLICY_RANDOM; p++) {
+        if (upper == POLICY_NAMES[p]) {
+            pol = (ReplacementPolicy)p;
+            return true;
         }
     }
-    
-    return false; 
+    return false;
 }
 
-void CacheLevel::handleReplacement(int setIndex, unsigned long tag) {
-    auto& set = sets[setIndex];
+const char* CacheLevel::policyName(ReplacementPolicy pol) {
+    return POLICY_NAMES[pol];
+}
 
-    // Case 1: Look for Empty Slot
-    for (auto& line : set.lines) {
-        if (!line.valid) {
-            line.valid = true;
-            line.tag = tag;
-            line.dirty = false; // Fresh from memory = Clean
-            line.insertionTime = globalTime;
-            line.lruTime = globalTime;
-            return;
-        }
-    }
+const char* CacheLevel::geometryError(size_t size, size_t blkSize, int assoc, ReplacementPolicy pol) {
+    if (blkSize == 0 || assoc <= 0 || assoc > MAX_WAYS) return "associativity must be 1..64";
+    if (size / (blkSize * assoc) == 0) return "size cannot hold one complete set";
+    if (pol == POLICY_PLRU && !isPowerOfTwo(assoc)) return "Tree-PLRU needs a power-of-two associativity";
+    return nullptr;
+}
 
-    // Case 2: Eviction Needed
-    int victimIndex = 0;
-    unsigned long minTime = -1; 
+template <typename Policy>
+static CacheLevel* createEngine(const std::string& name, size_t size, size_t blockSize, int assoc, unsigned seed) {
+    // Shapes compiled in full: the defaults and a typical 32 KiB L1
+#define FIXED_SHAPE(S, B, W) \
+    if (size == S && blockSize == B && assoc == W) return new FixedCacheLevel<Policy, S, B, W>(name, size, blockSize, assoc, seed)
+    FIXED_SHAPE(1024, 64, 2);
+    FIXED_SHAPE(4096, 64, 4);
+    FIXED_SHAPE(16384, 64, 8);
+    FIXED_SHAPE(32768, 64, 8);
+#undef FIXED_SHAPE
 
-    for (int i = 0; i < set.lines.size(); i++) {
-        unsigned long timeMetric = (policy == "FIFO") ? set.lines[i].insertionTime : set.lines[i].lruTime;
-        if (timeMetric < minTime) {
-            minTime = timeMetric;
-            victimIndex = i;
-        }
+    size_t numSets = size / (blockSize * assoc);
+    if (isPowerOfTwo(blockSize) && isPowerOfTwo(numSets)) {
+        return new CacheEngine<Policy, ShiftIndex>(name, size, blockSize, assoc, seed);
     }
+    return new CacheEngine<Policy, ModuloIndex>(name, size, blockSize, assoc, seed);
+}
 
-    // --- WRITE-BACK LOGIC ---
-    if (set.lines[victimIndex].dirty) {
-        std::cout << "   [!CACHE EVICTION!] " << levelName << ": Writing dirty block 0x" 
-                  << std::hex << set.lines[victimIndex].tag << std::dec << " back to Memory." << std::endl;
-    }
-    // ------------------------
+CacheLevel* CacheLevel::create(std::string name, size_t size, size_t blkSize, int assoc,
+                               ReplacementPolicy pol, unsigned seed) {
+    if (geometryError(size, blkSize, assoc, pol)) return nullptr;
 
-    // Replace
-    set.lines[victimIndex].tag = tag;
-    set.lines[victimIndex].dirty = false; // New data is clean
-    set.lines[victimIndex].insertionTime = globalTime;
-    set.lines[victimIndex].lruTime = globalTime;
+    CacheLevel* level = nullptr;
+    switch (pol) {
+        case POLICY_LRU: level = createEngine<LruPolicy>(name, size, blkSize, assoc, seed); break;
+        case POLICY_FIFO: level = createEngine<FifoPolicy>(name, size, blkSize, assoc, seed); break;
+        case POLICY_PLRU: level = createEngine<PlruPolicy>(name, size, blkSize, assoc, seed); break;
+        case POLICY_SRRIP: level = createEngine<RripPolicy<false> >(name, size, blkSize, assoc, seed); break;
+        case POLICY_BRRIP: level = createEngine<RripPolicy<true> >(name, size, blkSize, assoc, seed); break;
+        case POLICY_NRU: level = createEngine<NruPolicy>(name, size, blkSize, assoc, seed); break;
+        case POLICY_RANDOM: level = createEngine<RandomPolicy>(name, size, blkSize, assoc, seed); break;
+    }
+    MEMSIM_LOG(std::cout << "[" << name << "] Initialized: " << size << " bytes, " 
+              << level->numSets << " sets, " << assoc << "-way, " << policyName(pol)
+              << " (" << level->engineName() << " engine, " << tagMatchName() << " tags)." << std::endl);
+    return level;
 }
 
 // >>> UPDATED FUNCTION <<<
 void CacheLevel::showStats() {
-    long total = hits + misses;
+    uint64_t total = hits + misses;
     double hitRate = (total > 0) ? (double)hits / total * 100.0 : 0.0;
     
     // Matches format: [L1] Hits: 4  Misses: 18  HitRate: 18.18%
@@ -115,92 +99,578 @@ void CacheLevel::showStats() {
 
 // ================= CacheController Implementation =================
 
+const int CacheController::MAX_CORES;
+
 CacheController::CacheController() {
     // Defaults
-    l1 = new CacheLevel("L1", 1024, 64, 2, "LRU");
-    l2 = new CacheLevel("L2", 4096, 64, 4, "LRU");
-    l3 = new CacheLevel("L3", 16384, 64, 8, "FIFO");
+    shapes[0] = {1024, 64, 2, POLICY_LRU, 1};
+    shapes[1] = {4096, 64, 4, POLICY_LRU, 1};
+    shapes[2] = {16384, 64, 8, POLICY_FIFO, 1};
+    for (auto& config : prefetchConfigs) config = Prefetcher::defaults(PREFETCH_OFF);
+    buildCores(1);
+    l3 = CacheLevel::create("L3", 16384, 64, 8, POLICY_FIFO);
+    l3Prefetcher = nullptr;
+    protocol = PROTOCOL_MESI;
+    parallel = nullptr;
+    parallelThreads = 0;
     // Initialize counters
     totalAccessCycles = 0;
     totalRequests = 0;
+    translationCycles = 0;
+    swapCycles = 0;
 }
 
 CacheController::~CacheController() {
-    delete l1; delete l2; delete l3;
+    delete parallel;
+    deleteCores();
+    delete l3;
+    delete l3Prefetcher;
+}
+
+void CacheController::buildCores(int count) {
+    cores.assign(count, Core());
+    for (int c = 0; c < count; c++) {
+        Core& core = cores[c];
+        const CacheShape& s1 = shapes[0];
+        const CacheShape& s2 = shapes[1];
+        core.l1 = CacheLevel::create("L1", s1.size, s1.blockSize, s1.assoc, s1.policy, s1.seed);
+        core.l2 = CacheLevel::create("L2", s2.size, s2.blockSize, s2.assoc, s2.policy, s2.seed);
+        core.l1->setCore(c);
+        core.l2->setCore(c);
+        core.requests = core.cycles = 0;
+        core.coherenceMisses = core.invalidations = 0;
+        core.prefetchers[0] = Prefetcher::create(prefetchConfigs[0]);
+        core.prefetchers[1] = Prefetcher::create(prefetchConfigs[1]);
+    }
+    currentCore = 0;
+    lineShift = log2Exact(shapes[0].blockSize);
+    directory.clear();
+    upgrades = invalidations = transfers = coherenceWritebacks = 0;
+}
+
+void CacheController::deleteCores() {
+    for (auto& core : cores) {
+        delete core.l1;
+        delete core.l2;
+        delete core.prefetchers[0];
+        delete core.prefetchers[1];
+    }
+    cores.clear();
 }
 
 // Runtime Configuration
-void CacheController::configCache(std::string level, size_t size, size_t blockSize, int assoc, std::string policy) {
-    if (level == "L1") {
-        delete l1;
-        l1 = new CacheLevel("L1", size, blockSize, assoc, policy);
-    } else if (level == "L2") {
-        delete l2;
-        l2 = new CacheLevel("L2", size, blockSize, assoc, policy);
-    } else if (level == "L3") {
-        delete l3;
-        l3 = new CacheLevel("L3", size, blockSize, assoc, policy);
-    } else {
+void CacheController::configCache(std::string level, size_t size, size_t blockSize, int assoc, std::string policy,
+                                  unsigned seed) {
+    if (level != "L1" && level != "L2" && level != "L3") {
         std::cout << "Invalid Cache Level: " << level << std::endl;
+        return;
+    }
+
+    ReplacementPolicy pol;
+    if (!CacheLevel::parsePolicy(policy, pol)) {
+        std::cout << "Invalid Cache Policy: " << policy << std::endl;
+        return;
+    }
+    const char* error = CacheLevel::geometryError(size, blockSize, assoc, pol);
+    if (!error && level != "L3" && cores.size() > 1) {
+        // Coherence tracks one line size across a core's private levels
+        size_t other = shapes[level == "L1" ? 1 : 0].blockSize;
+        if (blockSize != other) error = "L1 and L2 must share a block size with more than one core";
     }
+    if (error) {
+        std::cout << "Invalid Cache Geometry: " << error << std::endl;
+        return;
+    }
+
+    drainParallel();
+    if (level == "L3") {
+        CacheLevel* replacement = CacheLevel::create(level, size, blockSize, assoc, pol, seed);
+        delete l3;
+        l3 = replacement;
+        shapes[2] = {size, blockSize, assoc, pol, seed};
+        // The prefetcher's tables are in the old level's lines
+        delete l3Prefetcher;
+        l3Prefetcher = Prefetcher::create(prefetchConfigs[2]);
+        rebuildParallel();
+        return;
+    }
+
+    // Every core gets the new private level
+    int slot = (level == "L1") ? 0 : 1;
+    shapes[slot] = {size, blockSize, assoc, pol, seed};
+    for (int c = 0; c < (int)cores.size(); c++) {
+        CacheLevel*& target = (slot == 0) ? cores[c].l1 : cores[c].l2;
+        CacheLevel* replacement = CacheLevel::create(level, size, blockSize, assoc, pol, seed);
+        replacement->setCore(c);
+        delete target;
+        target = replacement;
+        delete cores[c].prefetchers[slot];
+        cores[c].prefetchers[slot] = Prefetcher::create(prefetchConfigs[slot]);
+    }
+    if (slot == 0) lineShift = log2Exact(blockSize);
+    directory.clear();
+    rebuildParallel();
 }
 
-void CacheController::accessMemory(unsigned long address, bool isWrite) {
-    std::cout << "\nCPU " << (isWrite ? "WRITE" : "READ") << " Request: 0x" << std::hex << address << std::dec << std::endl;
+bool CacheController::configCores(int count, const std::string& protocolName) {
+    if (count < 1 || count > MAX_CORES) {
+        std::cout << "Invalid core count: 1.." << MAX_CORES << std::endl;
+        return false;
+    }
+    if (protocolName == "mesi" || protocolName == "MESI") protocol = PROTOCOL_MESI;
+    else if (protocolName == "moesi" || protocolName == "MOESI") protocol = PROTOCOL_MOESI;
+    else {
+        std::cout << "Invalid coherence protocol: " << protocolName << std::endl;
+        return false;
+    }
+    if (count > 1 && shapes[0].blockSize != shapes[1].blockSize) {
+        std::cout << "Invalid Cache Geometry: L1 and L2 must share a block size with more than one core" << std::endl;
+        return false;
+    }
+    drainParallel();
+    deleteCores();
+    buildCores(count);
+    rebuildParallel();
+    return true;
+}
+
+bool CacheController::selectCore(int c) {
+    if (c < 0 || c >= (int)cores.size()) return false;
+    currentCore = c;
+    return true;
+}
+
+void CacheController::accessMemory(uint64_t address, bool isWrite) {
+    MEMSIM_LOG(std::cout << "\nCPU " << (isWrite ? "WRITE" : "READ") << " Request: 0x" << std::hex << address << std::dec << std::endl);
     
     totalRequests++;
+    Core& core = cores[currentCore];
+    if (parallel) {
+        core.requests++;
+        parallel->access(address, isWrite, false);
+        return;
+    }
+    int servedBy = 0;
+    int currentAccessCost = cores.size() > 1 ? coherentLookup(currentCore, address, isWrite, &servedBy)
+                                             : lookup(core, address, isWrite, false, &servedBy);
+    if (prefetching()) currentAccessCost += (int)runPrefetchers(currentCore, address, servedBy, true);
+    MEMSIM_EVENT(EV_ACCESS, EVSRC_CPU, isWrite, address, currentAccessCost);
+    
+    // Add this request's cost to the total system history
+    totalAccessCycles += currentAccessCost;
+    core.requests++;
+    core.cycles += currentAccessCost;
+}
+
+void CacheController::accessPageWalk(uint64_t address) {
+    MEMSIM_LOG(std::cout << "\nMMU PAGE WALK Read: 0x" << std::hex << address << std::dec << std::endl);
+    if (parallel) {
+        parallel->access(address, false, true);
+        return;
+    }
+    int servedBy = 0;
+    int cost = cores.size() > 1 ? coherentLookup(currentCore, address, false, &servedBy)
+                                : lookup(cores[currentCore], address, false, false, &servedBy);
+    if (prefetching()) cost += (int)runPrefetchers(currentCore, address, servedBy, false);
+    translationCycles += cost;
+    cores[currentCore].cycles += cost;
+}
+
+int CacheController::lookupLevels(CacheLevel* l1, CacheLevel* l2, CacheLevel* l3, uint64_t address, bool isWrite,
+                                  bool peerSupplies, int* servedBy) {
     int currentAccessCost = 0;
+    int level = 1;
 
     // 1. Check L1
     currentAccessCost += L1_LATENCY; // Always pay L1 cost
     if (l1->access(address, isWrite)) {
-        std::cout << "-> L1 Hit (Cost: " << currentAccessCost << " cycles)" << std::endl;
+        MEMSIM_LOG(std::cout << "-> L1 Hit (Cost: " << currentAccessCost << " cycles)" << std::endl);
     } 
     else {
-        std::cout << "-> L1 Miss" << std::endl;
+        MEMSIM_LOG(std::cout << "-> L1 Miss" << std::endl);
         
         // 2. Check L2 (Penalty propagated)
+        level = 2;
         currentAccessCost += L2_LATENCY;
         if (l2->access(address, isWrite)) {
-            std::cout << "-> L2 Hit (Cost: " << currentAccessCost << " cycles)" << std::endl;
+            MEMSIM_LOG(std::cout << "-> L2 Hit (Cost: " << currentAccessCost << " cycles)" << std::endl);
         } 
         else {
-            std::cout << "-> L2 Miss" << std::endl;
+            MEMSIM_LOG(std::cout << "-> L2 Miss" << std::endl);
             
             // 3. Check L3 (Penalty propagated)
             currentAccessCost += L3_LATENCY;
-            if (l3->access(address, isWrite)) {
-                std::cout << "-> L3 Hit (Cost: " << currentAccessCost << " cycles)" << std::endl;
+            bool l3Hit = l3->access(address, isWrite);
+            level = l3Hit ? 3 : 4;
+            if (peerSupplies) {
+                // The L3 copy, if any, is stale: the dirty owner sends the line
+                currentAccessCost += TRANSFER_LATENCY;
+                MEMSIM_LOG(std::cout << "-> Line sent by another core (Total Cost: " << currentAccessCost << " cycles)" << std::endl);
+            }
+            else if (l3Hit) {
+                MEMSIM_LOG(std::cout << "-> L3 Hit (Cost: " << currentAccessCost << " cycles)" << std::endl);
             } 
             else {
-                std::cout << "-> L3 Miss (Accessing Main Memory)" << std::endl;
+                MEMSIM_LOG(std::cout << "-> L3 Miss (Accessing Main Memory)" << std::endl);
                 // 4. Main Memory (Huge Penalty)
                 currentAccessCost += RAM_LATENCY;
-                std::cout << "-> Main Memory Access (Total Cost: " << currentAccessCost << " cycles)" << std::endl;
+                MEMSIM_LOG(std::cout << "-> Main Memory Access (Total Cost: " << currentAccessCost << " cycles)" << std::endl);
             }
         }
     }
-    
-    // Add this request's cost to the total system history
-    totalAccessCycles += currentAccessCost;
+    if (servedBy) *servedBy = level;
+    return currentAccessCost;
+}
+
+// ---------------- Coherence ----------------
+
+CoherenceState CacheController::coreState(const Core& core, uint64_t address) const {
+    CoherenceState s1 = core.l1->lineState(address);
+    return s1 != LINE_INVALID ? s1 : core.l2->lineState(address);
+}
+
+void CacheController::setCoreState(Core& core, uint64_t address, CoherenceState state) {
+    core.l1->setLineState(address, state);
+    core.l2->setLineState(address, state);
+}
+
+void CacheController::invalidatePeer(int p, uint64_t address) {
+    setCoreState(cores[p], address, LINE_INVALID);
+    cores[p].invalidations++;
+    invalidations++;
+    MEMSIM_EVENT(EV_INVALIDATE, EVSRC_DIR, p, address, currentCore);
+    MEMSIM_LOG(std::cout << "   [COHERENCE] Core " << p << " copy of 0x" << std::hex << address << std::dec
+              << " invalidated." << std::endl);
+}
+
+// Lines a core's private levels evicted leave the directory once neither
+// level holds them
+void CacheController::forgetVictims(int c) {
+    Core& core = cores[c];
+    CacheLevel* levels[2] = {core.l1, core.l2};
+    uint64_t victim;
+    for (CacheLevel* level : levels) {
+        if (!level->lastVictim(victim) || coreState(core, victim) != LINE_INVALID) continue;
+        auto it = directory.find(victim >> lineShift);
+        if (it == directory.end()) continue;
+        it->second &= ~((uint64_t)1 << c);
+        if (it->second == 0) directory.erase(it);
+    }
+}
+
+// A miss snoops the cores the directory lists: a write invalidates their
+// copies, a read demotes them to shared (MESI writes a dirty one back to
+// the L3 first; MOESI leaves it with its owner). A dirty copy is sent
+// straight to the requester. A write to a shared line first invalidates
+// the other copies through the directory (an upgrade).
+int CacheController::coherentLookup(int c, uint64_t address, bool isWrite, int* servedBy) {
+    Core& core = cores[c];
+    uint64_t line = address >> lineShift;
+    uint64_t self = (uint64_t)1 << c;
+    auto entry = directory.find(line);
+    uint64_t peers = (entry == directory.end()) ? 0 : entry->second & ~self;
+
+    CoherenceState held = coreState(core, address);
+    CoherenceState next = held;
+    bool peerSupplies = false;
+    int cost = 0;
+
+    if (held == LINE_INVALID) {
+        if (core.l1->invalidatedLine(address) || core.l2->invalidatedLine(address)) core.coherenceMisses++;
+        bool shared = false;
+        while (peers) {
+            int p = findFirstSet(peers);
+            peers &= peers - 1;
+            CoherenceState state = coreState(cores[p], address);
+            if (state == LINE_INVALID) continue;
+            if (state == LINE_MODIFIED || state == LINE_OWNED) peerSupplies = true;
+            if (isWrite) {
+                invalidatePeer(p, address);
+                continue;
+            }
+            shared = true;
+            if (state == LINE_MODIFIED && protocol == PROTOCOL_MESI) {
+                coherenceWritebacks++;
+                MEMSIM_EVENT(EV_WRITEBACK, EVSRC_DIR, p, address, core.l1->getBlockSize());
+                setCoreState(cores[p], address, LINE_SHARED);
+            } else if (state == LINE_MODIFIED) {
+                setCoreState(cores[p], address, LINE_OWNED);
+            } else if (state == LINE_EXCLUSIVE) {
+                setCoreState(cores[p], address, LINE_SHARED);
+            }
+        }
+        if (peerSupplies) transfers++;
+        next = isWrite ? LINE_MODIFIED : (shared ? LINE_SHARED : LINE_EXCLUSIVE);
+    } else if (isWrite) {
+        if (held == LINE_SHARED || held == LINE_OWNED) {
+            // The request goes to the directory at the L3 and back
+            upgrades++;
+            cost += L3_LATENCY;
+            while (peers) {
+                int p = findFirstSet(peers);
+                peers &= peers - 1;
+                if (coreState(cores[p], address) != LINE_INVALID) invalidatePeer(p, address);
+            }
+        }
+        next = LINE_MODIFIED;
+    }
+
+    cost += lookup(core, address, isWrite, peerSupplies, servedBy);
+    setCoreState(core, address, next);
+    if (isWrite) directory[line] = self;
+    else directory[line] |= self;
+    forgetVictims(c);
+    return cost;
+}
+
+// ---------------- Prefetching ----------------
+
+bool CacheController::configPrefetch(const std::string& level, const PrefetchConfig& config) {
+    if (level != "L1" && level != "L2" && level != "L3") {
+        std::cout << "Invalid Cache Level: " << level << std::endl;
+        return false;
+    }
+    const char* error = Prefetcher::configError(config);
+    if (!error && parallel && config.kind != PREFETCH_OFF) error = "not with parallel simulation";
+    if (error) {
+        std::cout << "Invalid prefetcher: " << error << std::endl;
+        return false;
+    }
+
+    int slot = (level == "L1") ? 0 : (level == "L2") ? 1 : 2;
+    prefetchConfigs[slot] = config;
+    if (slot == 2) {
+        delete l3Prefetcher;
+        l3Prefetcher = Prefetcher::create(config);
+        return true;
+    }
+    for (auto& core : cores) {
+        delete core.prefetchers[slot];
+        core.prefetchers[slot] = Prefetcher::create(config);
+    }
+    return true;
+}
+
+// Every level the reference reached trains its prefetcher: the levels that
+// missed and the one that hit. Time is the core's own cycle count, which a
+// fetch issued now completes ahead of by the latency of the levels below
+// the target that it has to go through.
+uint64_t CacheController::runPrefetchers(int c, uint64_t address, int servedBy, bool train) {
+    Core& core = cores[c];
+    CacheLevel* levels[3] = {core.l1, core.l2, l3};
+    Prefetcher* prefetchers[3] = {core.prefetchers[0], core.prefetchers[1], l3Prefetcher};
+    uint64_t stall = 0;
+
+    for (int i = 0; i < 3 && i < servedBy; i++) {
+        Prefetcher* prefetcher = prefetchers[i];
+        if (!prefetcher) continue;
+        bool hit = (i + 1 == servedBy);
+        bool prefetchHit = hit && levels[i]->lastHitPrefetched();
+        uint64_t line = address / levels[i]->getBlockSize();
+        if (prefetchHit) stall += prefetcher->used(line, core.cycles);
+        if (!hit) prefetcher->demandMiss(line);
+        if (!train) continue;
+
+        prefetchCandidates.clear();
+        prefetcher->train(line, !hit, prefetchHit, prefetchCandidates);
+        for (uint64_t candidate : prefetchCandidates) issuePrefetch(c, i, candidate);
+    }
+    return stall;
+}
+
+// Fills one proposed line into level (0..2). In the private levels of a
+// multi-core run the line comes in exclusive unless the core already holds
+// it, and a line any other core may hold is not prefetched. The levels below the target are only probed for
+// the fetch latency, not filled.
+void CacheController::issuePrefetch(int c, int level, uint64_t line) {
+    Core& core = cores[c];
+    CacheLevel* levels[3] = {core.l1, core.l2, l3};
+    Prefetcher* prefetcher = (level == 2) ? l3Prefetcher : core.prefetchers[level];
+    size_t blockSize = levels[level]->getBlockSize();
+    uint64_t address = line * blockSize;
+    if (address / blockSize != line) return;
+
+    bool coherent = cores.size() > 1 && level < 2;
+    CoherenceState held = LINE_INVALID;
+    if (coherent) {
+        auto entry = directory.find(address >> lineShift);
+        if (entry != directory.end() && (entry->second & ~((uint64_t)1 << c))) return;
+        held = coreState(core, address);
+    }
+    if (!levels[level]->prefetch(address)) return;
+
+    static const int BELOW[3] = {L2_LATENCY, L3_LATENCY, RAM_LATENCY};
+    uint64_t latency = 0;
+    for (int i = level + 1; i <= 3; i++) {
+        latency += BELOW[i - 1];
+        if (i == 3 || levels[i]->lineState(address) != LINE_INVALID) break;
+    }
+    prefetcher->issued(line, core.cycles + latency);
+    MEMSIM_LOG(std::cout << "   -> L" << level + 1 << " prefetch of 0x"
+              << std::hex << address << std::dec << " (ready in " << latency << " cycles)" << std::endl);
+
+    uint64_t victim;
+    if (levels[level]->lastVictim(victim)) prefetcher->displacedLine(victim / blockSize);
+    if (coherent) {
+        // A copy in the core's other private level keeps its state
+        setCoreState(core, address, held != LINE_INVALID ? held : LINE_EXCLUSIVE);
+        directory[address >> lineShift] |= (uint64_t)1 << c;
+        forgetVictims(c);
+    }
+}
+
+// ---------------- Parallel simulation ----------------
+
+// Brings the levels' stats and the cycle totals up to date with every
+// reference queued so far
+void CacheController::drainParallel() {
+    if (!parallel) return;
+    CacheLevel* levels[3] = {cores[0].l1, cores[0].l2, l3};
+    unsigned long long accessCycles = 0, walkCycles = 0;
+    parallel->drain(levels, accessCycles, walkCycles);
+    totalAccessCycles += accessCycles;
+    translationCycles += walkCycles;
+    cores[0].cycles += accessCycles + walkCycles;
+}
+
+// After a reconfiguration: the sharded copy starts over from the new,
+// empty levels, or is dropped if they no longer split
+bool CacheController::rebuildParallel() {
+    if (!parallelThreads) return true;
+    delete parallel;
+    parallel = nullptr;
+    const char* error = "the caches are shared by more than one core";
+    if (cores.size() == 1) parallel = ParallelCacheSim::create(shapes, parallelThreads, error);
+    if (!parallel) {
+        std::cout << "Parallel simulation off: " << error << std::endl;
+        parallelThreads = 0;
+        return false;
+    }
+    return true;
+}
+
+bool CacheController::configParallel(int threads) {
+    drainParallel();
+    delete parallel;
+    parallel = nullptr;
+    parallelThreads = 0;
+    if (threads <= 1) return true;
+
+    const char* error = nullptr;
+    if (cores.size() > 1) error = "needs a single core";
+    else if (EventLog::verbosity != VERBOSITY_QUIET) error = "needs verbosity quiet";
+    else if (prefetching()) error = "prefetchers cross the set shards; turn them off";
+    if (!error) parallel = ParallelCacheSim::create(shapes, threads, error);
+    if (!parallel) {
+        std::cout << "Invalid parallel simulation: " << error << std::endl;
+        return false;
+    }
+
+    // The shards start empty, so the serial levels must too
+    deleteCores();
+    buildCores(1);
+    CacheLevel* replacement = CacheLevel::create("L3", shapes[2].size, shapes[2].blockSize, shapes[2].assoc,
+                                                 shapes[2].policy, shapes[2].seed);
+    delete l3;
+    l3 = replacement;
+    parallelThreads = threads;
+    return true;
+}
+
+// One line per level with a prefetcher, summed over the cores
+void CacheController::showPrefetchStats() {
+    for (int slot = 0; slot < 3; slot++) {
+        const PrefetchConfig& config = prefetchConfigs[slot];
+        if (config.kind == PREFETCH_OFF) continue;
+        PrefetchStats total = {0, 0, 0, 0, 0};
+        for (size_t c = 0; c < (slot == 2 ? 1 : cores.size()); c++) {
+            const Prefetcher* prefetcher = (slot == 2) ? l3Prefetcher : cores[c].prefetchers[slot];
+            const PrefetchStats& s = prefetcher->stats();
+            total.issued += s.issued;
+            total.useful += s.useful;
+            total.late += s.late;
+            total.evictions += s.evictions;
+            total.pollution += s.pollution;
+        }
+        double accuracy = total.issued > 0 ? (double)total.useful / total.issued * 100.0 : 0.0;
+        std::cout << "[L" << slot + 1 << " prefetch] " << Prefetcher::kindName(config.kind) << " (degree "
+                  << config.degree << ", distance " << config.distance << "): Issued: " << total.issued
+                  << " Useful: " << total.useful << " (" << std::fixed << std::setprecision(2) << accuracy
+                  << "%) Late: " << total.late << " Evictions: " << total.evictions
+                  << " Pollution misses: " << total.pollution << std::endl;
+    }
+}
+
+double CacheController::hitRate(int level) {
+    drainParallel();
+    uint64_t hits = 0, misses = 0;
+    if (level == 3) {
+        hits = l3->getHits();
+        misses = l3->getMisses();
+    } else {
+        for (const auto& core : cores) {
+            const CacheLevel* l = (level == 1) ? core.l1 : core.l2;
+            hits += l->getHits();
+            misses += l->getMisses();
+        }
+    }
+    return (hits + misses > 0) ? (double)hits / (hits + misses) * 100.0 : 0.0;
+}
+
+double CacheController::amat() {
+    drainParallel();
+    if (totalRequests == 0) return 0.0;
+    return (double)(totalAccessCycles + translationCycles + swapCycles) / totalRequests;
 }
 
 // >>> UPDATED FUNCTION <<<
 void CacheController::showStats() {
+    drainParallel();
     std::cout << "\n========== CACHE STATS ==========" << std::endl;
-    l1->showStats();
-    l2->showStats();
+    for (size_t c = 0; c < cores.size(); c++) {
+        if (cores.size() > 1) std::cout << "Core " << c << ":" << std::endl;
+        cores[c].l1->showStats();
+        cores[c].l2->showStats();
+    }
     l3->showStats();
+    showPrefetchStats();
     
     std::cout << "---------------------------------" << std::endl;
     std::cout << "Total Requests : " << totalRequests << std::endl;
-    std::cout << "Total Cycles   : " << totalAccessCycles << std::endl;
+    unsigned long long totalCycles = totalAccessCycles + translationCycles + swapCycles;
+    std::cout << "Total Cycles   : " << totalCycles << std::endl;
+    if (translationCycles > 0) {
+        std::cout << "Translation    : " << translationCycles << " cycles" << std::endl;
+    }
+    if (swapCycles > 0) {
+        std::cout << "Swap I/O       : " << swapCycles << " cycles" << std::endl;
+    }
     
     if (totalRequests > 0) {
-        double amat = (double)totalAccessCycles / totalRequests;
+        double amat = (double)totalCycles / totalRequests;
         std::cout << "AMAT           : " << std::fixed << std::setprecision(2) << amat << " cycles" << std::endl;
     } else {
         std::cout << "AMAT           : 0.00 cycles" << std::endl;
     }
+
+    if (cores.size() > 1) {
+        uint64_t coherenceMisses = 0;
+        for (const auto& core : cores) coherenceMisses += core.coherenceMisses;
+        std::cout << "---------------------------------" << std::endl;
+        std::cout << "Coherence      : " << (protocol == PROTOCOL_MESI ? "MESI" : "MOESI") << ", "
+                  << cores.size() << " cores, " << directory.size() << " lines tracked" << std::endl;
+        std::cout << "Invalidations  : " << invalidations << " (upgrades " << upgrades << ")" << std::endl;
+        std::cout << "Coherence miss : " << coherenceMisses << std::endl;
+        std::cout << "Core transfers : " << transfers;
+        if (protocol == PROTOCOL_MESI) std::cout << " (" << coherenceWritebacks << " written back)";
+        std::cout << std::endl;
+        for (size_t c = 0; c < cores.size(); c++) {
+            const Core& core = cores[c];
+            double amat = core.requests > 0 ? (double)core.cycles / core.requests : 0.0;
+            std::cout << "Core " << c << " AMAT    : " << std::fixed << std::setprecision(2) << amat
+                      << " cycles over " << core.requests << " requests, " << core.coherenceMisses
+                      << " coherence misses, " << core.invalidations << " lines invalidated" << std::endl;
+        }
+    }
     std::cout << "=================================" << std::endl;
-}
\ No newline at end of file
+}
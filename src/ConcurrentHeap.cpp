@@ -0,0 +1,299 @@
+#include "../include/ConcurrentHeap.h"
+#include "../include/EventLog.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+
+const int ConcurrentHeap::NUM_CLASSES;
+const size_t ConcurrentHeap::CLASS_SIZES[ConcurrentHeap::NUM_CLASSES] = { 16, 32, 64, 128, 256 };
+const int ConcurrentHeap::MAGAZINE_SIZE;
+const int ConcurrentHeap::REFILL_BATCH;
+const size_t ConcurrentHeap::LIVE_LIMIT;
+
+ConcurrentHeap::ConcurrentHeap(MemoryManager* heap, int threads)
+    : central(heap), opsPerThread(0), remotePercent(0), liveBefore(0), liveAfter(0) {
+    for (int t = 0; t < threads; t++) {
+        Worker* w = new Worker();
+        for (int c = 0; c < NUM_CLASSES; c++) w->magazines[c].reserve(MAGAZINE_SIZE + REFILL_BATCH);
+        workers.push_back(w);
+    }
+}
+
+ConcurrentHeap::~ConcurrentHeap() {
+    drainAll();
+    for (Worker* w : workers) delete w;
+}
+
+unsigned ConcurrentHeap::nextRandom(unsigned& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// ---------------- Central heap access ----------------
+
+void ConcurrentHeap::lockCentral(Worker& w) {
+    if (!centralLock.try_lock()) {
+        w.lockContended++;
+        centralLock.lock();
+    }
+    w.lockAcquisitions++;
+}
+
+void ConcurrentHeap::releaseToCentral(Worker& w, Object** objs, size_t count) {
+    lockCentral(w);
+    for (size_t i = 0; i < count; i++) central->deallocate(objs[i]->id);
+    centralLock.unlock();
+    for (size_t i = 0; i < count; i++) delete objs[i];
+}
+
+// ---------------- Per-thread fast paths ----------------
+
+ConcurrentHeap::Object* ConcurrentHeap::allocateObject(Worker& w, int tid, size_t size, int sizeClass) {
+    if (sizeClass < 0) {
+        // Large objects bypass the thread cache
+        lockCentral(w);
+        bool ok = central->allocate(size);
+        int id = central->lastBlockId();
+        centralLock.unlock();
+        if (!ok) return nullptr;
+
+        Object* obj = new Object();
+        obj->id = id;
+        obj->sizeClass = -1;
+        obj->owner = tid;
+        obj->next = nullptr;
+        return obj;
+    }
+
+    std::vector<Object*>& mag = w.magazines[sizeClass];
+    if (mag.empty()) {
+        // Remote frees may have refilled the magazine without a lock
+        drainRemoteFrees(w);
+    }
+    if (!mag.empty()) {
+        w.cacheHits++;
+    } else {
+        w.refills++;
+        w.refillsByClass[sizeClass]++;
+        lockCentral(w);
+        for (int i = 0; i < REFILL_BATCH; i++) {
+            if (!central->allocate(CLASS_SIZES[sizeClass])) break;
+            Object* obj = new Object();
+            obj->id = central->lastBlockId();
+            obj->sizeClass = sizeClass;
+            obj->owner = tid;
+            obj->next = nullptr;
+            mag.push_back(obj);
+        }
+        centralLock.unlock();
+        if (mag.empty()) return nullptr;
+    }
+
+    Object* obj = mag.back();
+    mag.pop_back();
+    return obj;
+}
+
+// Owner-side free: back into the magazine, flushing half of it to the
+// central heap once it overflows.
+void ConcurrentHeap::freeObject(Worker& w, Object* obj) {
+    if (obj->sizeClass < 0) {
+        releaseToCentral(w, &obj, 1);
+        return;
+    }
+
+    std::vector<Object*>& mag = w.magazines[obj->sizeClass];
+    mag.push_back(obj);
+    if ((int)mag.size() > MAGAZINE_SIZE) {
+        w.flushes++;
+        releaseToCentral(w, &mag[mag.size() - REFILL_BATCH], REFILL_BATCH);
+        mag.resize(mag.size() - REFILL_BATCH);
+    }
+}
+
+void ConcurrentHeap::drainRemoteFrees(Worker& w) {
+    Object* obj = w.remoteFrees.takeAll();
+    while (obj) {
+        Object* next = obj->next;
+        w.remoteFreesReceived++;
+        freeObject(w, obj);
+        obj = next;
+    }
+}
+
+// ---------------- Workload ----------------
+
+// Random malloc/free mix. With probability remotePercent a fresh object is
+// handed to another thread, which later frees it remotely.
+void ConcurrentHeap::workerLoop(int tid, unsigned seed) {
+    Worker& w = *workers[tid];
+    int threads = (int)workers.size();
+    unsigned rng = seed * 2654435761u + (unsigned)tid * 40503u + 1;
+    if (rng == 0) rng = 1;
+
+    auto start = std::chrono::steady_clock::now();
+    for (long op = 0; op < opsPerThread; op++) {
+        // Adopt objects other threads passed to us
+        for (Object* obj = w.handoff.takeAll(); obj; ) {
+            Object* next = obj->next;
+            w.held.push_back(obj);
+            obj = next;
+        }
+        if ((op & 63) == 0) drainRemoteFrees(w);
+
+        bool doAlloc = w.held.empty() || (w.held.size() < LIVE_LIMIT && (nextRandom(rng) & 1));
+        if (doAlloc) {
+            size_t size;
+            int sizeClass;
+            if (nextRandom(rng) % 10 == 0) {
+                sizeClass = -1;
+                size = CLASS_SIZES[NUM_CLASSES - 1] + 1 + nextRandom(rng) % 768;
+            } else {
+                sizeClass = (int)(nextRandom(rng) % NUM_CLASSES);
+                size = CLASS_SIZES[sizeClass];
+            }
+
+            Object* obj = allocateObject(w, tid, size, sizeClass);
+            if (!obj) {
+                w.failedAllocs++;
+                continue;
+            }
+            w.allocs++;
+
+            if (threads > 1 && (int)(nextRandom(rng) % 100) < remotePercent) {
+                int peer = (int)(nextRandom(rng) % (threads - 1));
+                if (peer >= tid) peer++;
+                workers[peer]->handoff.push(obj);
+            } else {
+                w.held.push_back(obj);
+            }
+        } else {
+            size_t i = nextRandom(rng) % w.held.size();
+            Object* obj = w.held[i];
+            w.held[i] = w.held.back();
+            w.held.pop_back();
+            w.frees++;
+
+            if (obj->owner == tid) {
+                freeObject(w, obj);
+            } else {
+                w.remoteFreesSent++;
+                workers[obj->owner]->remoteFrees.push(obj);
+            }
+        }
+    }
+    w.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Single-threaded: returns every object still cached, held or in flight
+void ConcurrentHeap::drainAll() {
+    std::vector<Object*> pending;
+    for (Worker* w : workers) {
+        for (Object* obj = w->handoff.takeAll(); obj; obj = obj->next) pending.push_back(obj);
+        for (Object* obj = w->remoteFrees.takeAll(); obj; obj = obj->next) pending.push_back(obj);
+        pending.insert(pending.end(), w->held.begin(), w->held.end());
+        w->held.clear();
+        for (int c = 0; c < NUM_CLASSES; c++) {
+            pending.insert(pending.end(), w->magazines[c].begin(), w->magazines[c].end());
+            w->magazines[c].clear();
+        }
+    }
+    for (Object* obj : pending) {
+        central->deallocate(obj->id);
+        delete obj;
+    }
+}
+
+void ConcurrentHeap::run(long ops, int remotePct, unsigned seed) {
+    opsPerThread = ops;
+    remotePercent = remotePct;
+    for (Worker* w : workers) {
+        w->allocs = w->frees = w->failedAllocs = 0;
+        w->remoteFreesSent = w->remoteFreesReceived = 0;
+        w->cacheHits = w->refills = w->flushes = 0;
+        w->lockAcquisitions = w->lockContended = 0;
+        for (int c = 0; c < NUM_CLASSES; c++) w->refillsByClass[c] = 0;
+        w->seconds = 0;
+    }
+
+    // The event log and console output are not thread-safe
+    int savedVerbosity = EventLog::verbosity;
+    EventLog::verbosity = VERBOSITY_QUIET;
+
+    liveBefore = central->liveBlocks();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < (int)workers.size(); t++) {
+        threads.push_back(std::thread(&ConcurrentHeap::workerLoop, this, t, seed));
+    }
+    for (auto& th : threads) th.join();
+
+    drainAll();
+    liveAfter = central->liveBlocks();
+    EventLog::verbosity = savedVerbosity;
+}
+
+void ConcurrentHeap::showStats() {
+    // Later stats blocks print with the console's own format
+    std::ios::fmtflags savedFlags = std::cout.flags();
+    std::streamsize savedPrecision = std::cout.precision();
+
+    std::cout << "=== CONCURRENT HEAP STATS ===" << std::endl;
+    std::cout << "Threads: " << workers.size() << ", ops/thread: " << opsPerThread
+              << ", remote handoff: " << remotePercent << "%" << std::endl;
+
+    std::cout << std::left << std::setw(8) << "Thread" << std::right
+              << std::setw(10) << "Allocs" << std::setw(10) << "Frees"
+              << std::setw(10) << "Failed" << std::setw(10) << "RemSent"
+              << std::setw(10) << "RemRecv" << std::setw(10) << "Hit%"
+              << std::setw(10) << "Refills" << std::setw(10) << "Flushes"
+              << std::setw(10) << "Locks" << std::setw(11) << "Contended"
+              << std::setw(10) << "Mops/s" << std::endl;
+
+    uint64_t totalOps = 0, totalLocks = 0, totalContended = 0;
+    uint64_t totalRefills[NUM_CLASSES] = { 0 };
+    double wall = 0;
+    for (size_t t = 0; t < workers.size(); t++) {
+        const Worker& w = *workers[t];
+        uint64_t cached = w.cacheHits + w.refills;
+        double hitRate = cached ? 100.0 * w.cacheHits / cached : 0.0;
+        double mops = w.seconds > 0 ? (w.allocs + w.frees) / w.seconds / 1e6 : 0.0;
+
+        std::cout << std::left << std::setw(8) << t << std::right
+                  << std::setw(10) << w.allocs << std::setw(10) << w.frees
+                  << std::setw(10) << w.failedAllocs << std::setw(10) << w.remoteFreesSent
+                  << std::setw(10) << w.remoteFreesReceived
+                  << std::setw(10) << std::fixed << std::setprecision(1) << hitRate
+                  << std::setw(10) << w.refills << std::setw(10) << w.flushes
+                  << std::setw(10) << w.lockAcquisitions << std::setw(11) << w.lockContended
+                  << std::setw(10) << std::setprecision(2) << mops << std::endl;
+
+        totalOps += w.allocs + w.frees;
+        totalLocks += w.lockAcquisitions;
+        totalContended += w.lockContended;
+        for (int c = 0; c < NUM_CLASSES; c++) totalRefills[c] += w.refillsByClass[c];
+        if (w.seconds > wall) wall = w.seconds;
+    }
+
+    std::cout << "Aggregate throughput: " << std::fixed << std::setprecision(2)
+              << (wall > 0 ? totalOps / wall / 1e6 : 0.0) << " Mops/s" << std::endl;
+    std::cout << "Lock contention: " << totalContended << " / " << totalLocks << " acquisitions ("
+              << std::setprecision(1) << (totalLocks ? 100.0 * totalContended / totalLocks : 0.0)
+              << "%)" << std::endl;
+
+    std::cout << "Cache refill histogram:" << std::endl;
+    uint64_t maxRefills = 1;
+    for (int c = 0; c < NUM_CLASSES; c++) if (totalRefills[c] > maxRefills) maxRefills = totalRefills[c];
+    for (int c = 0; c < NUM_CLASSES; c++) {
+        std::cout << "  " << std::setw(4) << CLASS_SIZES[c] << " B | "
+                  << std::left << std::setw(40) << std::string((size_t)(40 * totalRefills[c] / maxRefills), '#')
+                  << std::right << " " << totalRefills[c] << std::endl;
+    }
+
+    std::cout << "Central heap live blocks: " << liveBefore << " before, " << liveAfter << " after "
+              << (liveBefore == liveAfter ? "(consistent)" : "(MISMATCH)") << std::endl;
+    std::cout.flags(savedFlags);
+    std::cout.precision(savedPrecision);
+}
@@ -0,0 +1,122 @@
+#include "../include/EventLog.h"
+#include <cinttypes>
+
+static const size_t TEXT_BUFFER_SIZE = 1 << 20;
+static const size_t BINARY_BATCH = 4096;
+
+int EventLog::verbosity = VERBOSITY_VERBOSE;
+EventSink* EventLog::sink = nullptr;
+
+// ---------------- Sinks ----------------
+
+TextEventSink::TextEventSink(FILE* f) : out(f), buffer(TEXT_BUFFER_SIZE) {
+    std::setvbuf(out, buffer.data(), _IOFBF, buffer.size());
+}
+
+TextEventSink::~TextEventSink() {
+    std::fclose(out);
+}
+
+void TextEventSink::record(const Event& ev) {
+    std::fprintf(out, "%s %s id=%" PRIu32 " addr=0x%" PRIx64 " value=%" PRIu64 "\n",
+                 EventLog::sourceName(ev.source), EventLog::typeName(ev.type),
+                 ev.id, ev.address, ev.value);
+}
+
+void TextEventSink::flush() {
+    std::fflush(out);
+}
+
+BinaryEventSink::BinaryEventSink(FILE* f) : out(f) {
+    pending.reserve(BINARY_BATCH);
+    std::fwrite("MEMSIMEV", 1, 8, out);
+}
+
+BinaryEventSink::~BinaryEventSink() {
+    flush();
+    std::fclose(out);
+}
+
+void BinaryEventSink::record(const Event& ev) {
+    pending.push_back(ev);
+    if (pending.size() == BINARY_BATCH) flush();
+}
+
+void BinaryEventSink::flush() {
+    if (!pending.empty()) {
+        std::fwrite(pending.data(), sizeof(Event), pending.size(), out);
+        pending.clear();
+    }
+    std::fflush(out);
+}
+
+// ---------------- EventLog ----------------
+
+bool EventLog::parseVerbosity(const std::string& name, int& level) {
+    if (name == "quiet" || name == "0") level = VERBOSITY_QUIET;
+    else if (name == "events" || name == "1") level = VERBOSITY_EVENTS;
+    else if (name == "verbose" || name == "2") level = VERBOSITY_VERBOSE;
+    else return false;
+    return true;
+}
+
+const char* EventLog::verbosityName(int level) {
+    switch (level) {
+        case VERBOSITY_QUIET:  return "quiet";
+        case VERBOSITY_EVENTS: return "events";
+        default:               return "verbose";
+    }
+}
+
+bool EventLog::openLog(const std::string& path, bool binary) {
+    FILE* f = std::fopen(path.c_str(), binary ? "wb" : "w");
+    if (!f) return false;
+    closeLog();
+    if (binary) sink = new BinaryEventSink(f);
+    else sink = new TextEventSink(f);
+    return true;
+}
+
+void EventLog::closeLog() {
+    if (sink) {
+        sink->flush();
+        delete sink;
+        sink = nullptr;
+    }
+}
+
+const char* EventLog::typeName(uint8_t type) {
+    switch (type) {
+        case EV_HIT:        return "HIT";
+        case EV_MISS:       return "MISS";
+        case EV_EVICT:      return "EVICT";
+        case EV_WRITEBACK:  return "WRITEBACK";
+        case EV_FAULT:      return "FAULT";
+        case EV_ALLOC:      return "ALLOC";
+        case EV_ALLOC_FAIL: return "ALLOC_FAIL";
+        case EV_FREE:       return "FREE";
+        case EV_ACCESS:     return "ACCESS";
+        case EV_INVALIDATE: return "INVALIDATE";
+        case EV_PREFETCH:   return "PREFETCH";
+        default:            return "?";
+    }
+}
+
+const char* EventLog::sourceName(uint8_t source) {
+    switch (source) {
+        case EVSRC_L1:   return "L1";
+        case EVSRC_L2:   return "L2";
+        case EVSRC_L3:   return "L3";
+        case EVSRC_CPU:  return "CPU";
+        case EVSRC_VM:   return "VM";
+        case EVSRC_HEAP: return "HEAP";
+        case EVSRC_DIR:  return "DIR";
+        default:         return "?";
+    }
+}
+
+EventSource EventLog::cacheSource(const std::string& levelName) {
+    if (levelName == "L1") return EVSRC_L1;
+    if (levelName == "L2") return EVSRC_L2;
+    return EVSRC_L3;
+}
@@ -0,0 +1,110 @@
+#include "../include/FreeBlockIndex.h"
+#include "../include/MemoryManager.h"
+
+FreeBlockIndex::FreeBlockIndex() : root(-1), count(0), seed(0x9E3779B9u) {}
+
+// xorshift32: a fixed seed keeps the tree shape (and timings) reproducible
+unsigned FreeBlockIndex::nextPriority() {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+void FreeBlockIndex::update(int n) {
+    Node& node = nodes[n];
+    node.maxSize = node.blockSize;
+    if (node.left >= 0 && nodes[node.left].maxSize > node.maxSize) node.maxSize = nodes[node.left].maxSize;
+    if (node.right >= 0 && nodes[node.right].maxSize > node.maxSize) node.maxSize = nodes[node.right].maxSize;
+}
+
+// Splits subtree n into addresses < address (left) and >= address (right)
+void FreeBlockIndex::split(int n, size_t address, int& left, int& right) {
+    if (n < 0) {
+        left = right = -1;
+        return;
+    }
+    if (nodes[n].address < address) {
+        split(nodes[n].right, address, nodes[n].right, right);
+        left = n;
+    } else {
+        split(nodes[n].left, address, left, nodes[n].left);
+        right = n;
+    }
+    update(n);
+}
+
+int FreeBlockIndex::merge(int left, int right) {
+    if (left < 0) return right;
+    if (right < 0) return left;
+    if (nodes[left].priority > nodes[right].priority) {
+        nodes[left].right = merge(nodes[left].right, right);
+        update(left);
+        return left;
+    }
+    nodes[right].left = merge(left, nodes[right].left);
+    update(right);
+    return right;
+}
+
+void FreeBlockIndex::insert(size_t address, size_t size, Handle handle) {
+    int n;
+    if (!freeSlots.empty()) {
+        n = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        n = (int)nodes.size();
+        nodes.push_back(Node());
+    }
+    Node& node = nodes[n];
+    node.address = address;
+    node.blockSize = size;
+    node.maxSize = size;
+    node.priority = nextPriority();
+    node.left = node.right = -1;
+    node.handle = handle;
+
+    int left, right;
+    split(root, address, left, right);
+    root = merge(merge(left, n), right);
+    count++;
+}
+
+void FreeBlockIndex::erase(size_t address) {
+    int left, mid, right;
+    split(root, address, left, right);
+    split(right, address + 1, mid, right);
+    if (mid >= 0) {
+        freeSlots.push_back(mid);
+        count--;
+    }
+    root = merge(left, right);
+}
+
+void FreeBlockIndex::clear() {
+    nodes.clear();
+    freeSlots.clear();
+    root = -1;
+    count = 0;
+}
+
+FreeBlockIndex::Handle* FreeBlockIndex::find(size_t address) {
+    int n = root;
+    while (n >= 0) {
+        if (address == nodes[n].address) return &nodes[n].handle;
+        n = (address < nodes[n].address) ? nodes[n].left : nodes[n].right;
+    }
+    return nullptr;
+}
+
+FreeBlockIndex::Handle* FreeBlockIndex::firstFit(size_t request) {
+    int n = root;
+    if (n < 0 || nodes[n].maxSize < request) return nullptr;
+
+    while (true) {
+        int left = nodes[n].left;
+        if (left >= 0 && nodes[left].maxSize >= request) n = left;
+        else if (nodes[n].blockSize >= request) return &nodes[n].handle;
+        else n = nodes[n].right; // maxSize guarantees a fit on this side
+    }
+}
@@ -1,99 +1,154 @@
 #include "../include/MemoryManager.h"
+#include "../include/EventLog.h"
 #include <iostream>
 #include <limits>
 #include <iomanip>
 #include <cmath>
 
-MemoryManager::MemoryManager(size_t size) : totalMemorySize(size), nextBlockId(1), allocatorType("first") {
-    physicalMemory.resize(size, 0); 
+MemoryManager::MemoryManager(size_t size)
+    : totalMemorySize(size), physicalMemory(size), nextBlockId(1), allocatorType("first"), fitPolicy(FIT_FIRST) {
     memoryList.push_back(MemoryBlock(0, 0, size, true));
+    indexFreeBlock(memoryList.begin());
 }
 
 void MemoryManager::setAllocator(const std::string& type) {
     allocatorType = type;
-    std::cout << "Allocator set to: " << allocatorType << " fit" << std::endl;
+    if (type == "first") fitPolicy = FIT_FIRST;
+    else if (type == "best") fitPolicy = FIT_BEST;
+    else if (type == "worst") fitPolicy = FIT_WORST;
+    else fitPolicy = FIT_NONE; // Unknown strategy: nothing ever fits
+    MEMSIM_LOG(std::cout << "Allocator set to: " << allocatorType << " fit" << std::endl);
 }
 
-bool MemoryManager::allocate(size_t size) {
-    numAllocRequests++; // <--- NEW
+void MemoryManager::indexFreeBlock(BlockIter it) {
+    freeByAddress.insert(it->startAddress, it->size, it);
+    freeBySize.insert(std::make_pair(it->size, it->startAddress));
+}
+
+void MemoryManager::unindexFreeBlock(BlockIter it) {
+    freeByAddress.erase(it->startAddress);
+    freeBySize.erase(std::make_pair(it->size, it->startAddress));
+}
 
-    std::list<MemoryBlock>::iterator bestBlockIt = memoryList.end();
-    size_t bestSize = std::numeric_limits<size_t>::max();
-    size_t worstSize = 0; 
-
-    for (auto it = memoryList.begin(); it != memoryList.end(); ++it) {
-        if (it->isFree && it->size >= size) {
-            if (allocatorType == "first") {
-                bestBlockIt = it;
-                break;
-            } else if (allocatorType == "best") {
-                if (it->size < bestSize) {
-                    bestSize = it->size;
-                    bestBlockIt = it;
-                }
-            } else if (allocatorType == "worst") {
-                if (it->size > worstSize) {
-                    worstSize = it->size;
-                    bestBlockIt = it;
-                }
-            }
+// Same choice as a linear scan in address order: ties on size go to the
+// lowest address for both best and worst fit.
+MemoryManager::BlockIter MemoryManager::findFit(size_t size) {
+    FreeBlockIndex::Handle* handle = nullptr;
+
+    if (fitPolicy == FIT_FIRST) {
+        handle = freeByAddress.firstFit(size);
+    } else if (fitPolicy == FIT_BEST) {
+        auto it = freeBySize.lower_bound(std::make_pair(size, (size_t)0));
+        if (it != freeBySize.end()) handle = freeByAddress.find(it->second);
+    } else if (fitPolicy == FIT_WORST && !freeBySize.empty()) {
+        size_t largest = freeBySize.rbegin()->first;
+        if (largest >= size) {
+            auto it = freeBySize.lower_bound(std::make_pair(largest, (size_t)0));
+            handle = freeByAddress.find(it->second);
         }
     }
+    return handle ? *handle : memoryList.end();
+}
+
+// Takes `size` bytes from the first block the fit policy picks and splits
+// off the remainder. Used by allocate() and by subclasses that manage their
+// own sub-allocation on top of the block heap.
+MemoryManager::BlockIter MemoryManager::carveBlock(size_t size, int id) {
+    BlockIter block = findFit(size);
+    if (block == memoryList.end()) return block;
+
+    unindexFreeBlock(block);
+    block->isFree = false;
+    block->id = id;
+
+    if (block->size > size) {
+        size_t remainingSize = block->size - size;
+        size_t newStartAddress = block->startAddress + size;
+        block->size = size;
+        MemoryBlock newFreeBlock(0, newStartAddress, remainingSize, true);
+        indexFreeBlock(memoryList.insert(std::next(block), newFreeBlock));
+    }
+    return block;
+}
+
+void MemoryManager::releaseBlock(BlockIter block) {
+    block->isFree = true;
+    block->id = 0;
+    coalesceAround(block);
+}
+
+bool MemoryManager::allocate(size_t size) {
+    numAllocRequests++; // <--- NEW
+
+    BlockIter bestBlockIt = carveBlock(size, nextBlockId);
 
     if (bestBlockIt == memoryList.end()) {
-        std::cout << "Error: Not enough memory to allocate " << size << " bytes." << std::endl;
+        MEMSIM_LOG(std::cout << "Error: Not enough memory to allocate " << size << " bytes." << std::endl);
+        MEMSIM_EVENT(EV_ALLOC_FAIL, EVSRC_HEAP, 0, 0, size);
         numFailedAllocs++; // <--- NEW
         return false;
     }
 
     // Allocation Successful
-    bestBlockIt->isFree = false;
-    bestBlockIt->id = nextBlockId++;
+    nextBlockId++;
+    usedById[bestBlockIt->id] = bestBlockIt;
 
-    if (bestBlockIt->size > size) {
-        size_t remainingSize = bestBlockIt->size - size;
-        size_t newStartAddress = bestBlockIt->startAddress + size;
-        bestBlockIt->size = size;
-        MemoryBlock newFreeBlock(0, newStartAddress, remainingSize, true);
-        memoryList.insert(std::next(bestBlockIt), newFreeBlock);
-    }
-
-    std::cout << "Allocated block id=" << bestBlockIt->id 
-              << " at address=0x" << std::hex << bestBlockIt->startAddress << std::dec << std::endl;
+    MEMSIM_LOG(std::cout << "Allocated block id=" << bestBlockIt->id 
+              << " at address=0x" << std::hex << bestBlockIt->startAddress << std::dec << std::endl);
+    MEMSIM_EVENT(EV_ALLOC, EVSRC_HEAP, bestBlockIt->id, bestBlockIt->startAddress, bestBlockIt->size);
     
     numSuccessfulAllocs++; // <--- NEW
     return true;
 }
 
 bool MemoryManager::deallocate(int blockId) {
-    bool found = false;
-    for (auto& block : memoryList) {
-        if (!block.isFree && block.id == blockId) {
-            block.isFree = true;
-            block.id = 0;
-            found = true;
-            break;
-        }
-    }
-
-    if (!found) {
-        std::cout << "Error: Block ID " << blockId << " not found." << std::endl;
+    auto found = usedById.find(blockId);
+    if (found == usedById.end()) {
+        MEMSIM_LOG(std::cout << "Error: Block ID " << blockId << " not found." << std::endl);
         return false;
     }
 
-    std::cout << "Block " << blockId << " freed." << std::endl;
+    BlockIter block = found->second;
+    usedById.erase(found);
+    MEMSIM_EVENT(EV_FREE, EVSRC_HEAP, blockId, block->startAddress, block->size);
+
+    MEMSIM_LOG(std::cout << "Block " << blockId << " freed." << std::endl);
     numFrees++; // <--- NEW
-    coalesce();
+    releaseBlock(block);
     return true;
 }
 
+// Free blocks are never adjacent to each other, so a newly freed block can
+// only merge with its immediate neighbours.
+void MemoryManager::coalesceAround(BlockIter it) {
+    if (it != memoryList.begin()) {
+        BlockIter prev = std::prev(it);
+        if (prev->isFree) {
+            unindexFreeBlock(prev);
+            prev->size += it->size;
+            memoryList.erase(it);
+            it = prev;
+        }
+    }
+    BlockIter next = std::next(it);
+    if (next != memoryList.end() && next->isFree) {
+        unindexFreeBlock(next);
+        it->size += next->size;
+        memoryList.erase(next);
+    }
+    indexFreeBlock(it);
+}
+
 void MemoryManager::coalesce() {
     auto it = memoryList.begin();
     while (it != memoryList.end()) {
         auto nextIt = std::next(it);
         if (nextIt != memoryList.end() && it->isFree && nextIt->isFree) {
+            unindexFreeBlock(it);
+            unindexFreeBlock(nextIt);
             it->size += nextIt->size;
             memoryList.erase(nextIt);
+            indexFreeBlock(it);
         } else {
             ++it;
         }
@@ -130,6 +185,13 @@ void MemoryManager::showStats() {
         }
     }
 
+    // Base MemoryManager usually has 0 internal fragmentation (unless alignment padding is added)
+    printSummary(usedMemory, freeMemory, usedBlocks, freeBlocks, 0, largestFreeBlock);
+}
+
+// Shared by every allocator so all of them report the same summary block
+void MemoryManager::printSummary(size_t usedMemory, size_t freeMemory, size_t usedBlocks, size_t freeBlocks,
+                                 size_t internalFrag, size_t largestFreeBlock) {
     double utilPercent = (totalMemorySize > 0) ? ((double)usedMemory / totalMemorySize) * 100.0 : 0.0;
     double successRate = (numAllocRequests > 0) ? ((double)numSuccessfulAllocs / numAllocRequests) * 100.0 : 0.0;
     
@@ -146,8 +208,7 @@ void MemoryManager::showStats() {
     std::cout << "Free memory            : " << freeMemory << " bytes" << std::endl;
     std::cout << "Used blocks            : " << usedBlocks << std::endl;
     std::cout << "Free blocks            : " << freeBlocks << std::endl;
-    // Base MemoryManager usually has 0 internal fragmentation (unless alignment padding is added)
-    std::cout << "Internal fragmentation : 0 bytes" << std::endl;
+    std::cout << "Internal fragmentation : " << internalFrag << " bytes" << std::endl;
     std::cout << "Memory utilization     : " << std::fixed << std::setprecision(2) << utilPercent << "%" << std::endl;
     std::cout << "External fragmentation : " << std::fixed << std::setprecision(3) << extFrag << std::endl;
     std::cout << "Allocation requests    : " << numAllocRequests << std::endl;
@@ -156,4 +217,4 @@ void MemoryManager::showStats() {
     std::cout << "Frees                  : " << numFrees << std::endl;
     std::cout << "Success rate           : " << std::fixed << std::setprecision(2) << successRate << "%" << std::endl;
     std::cout << "---------------------------" << std::endl;
-}
\ No newline at end of file
+}
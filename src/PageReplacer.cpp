@@ -0,0 +1,415 @@
+#include "PageReplacer.h"
+#include <vector>
+#include <unordered_map>
+#include <cctype>
+
+using namespace std;
+
+// Doubly linked list threaded through per-frame arrays. Slot 0 is the
+// sentinel and frame f lives in slot f + 1, so the arrays only reach the
+// highest frame ever linked; the front is the oldest entry.
+class FrameList {
+private:
+    vector<uint64_t> prev;
+    vector<uint64_t> next;
+
+public:
+    static const uint64_t END = UINT64_MAX;     // END + 1 wraps to the sentinel slot
+
+    FrameList() : prev(1, 0), next(1, 0) {}
+
+    uint64_t front() const { return next[0] - 1; }
+    uint64_t after(uint64_t frame) const { return next[frame + 1] - 1; }
+    bool at_end(uint64_t frame) const { return frame == END; }
+
+    void push_back(uint64_t frame) { insert_before(frame, END); }
+
+    void remove(uint64_t frame) {
+        uint64_t slot = frame + 1;
+        next[prev[slot]] = next[slot];
+        prev[next[slot]] = prev[slot];
+    }
+
+    void move_to_back(uint64_t frame) {
+        remove(frame);
+        push_back(frame);
+    }
+
+    // pos may be end(), which makes this a push_back
+    void insert_before(uint64_t frame, uint64_t pos) {
+        uint64_t slot = frame + 1, at = pos + 1;
+        if (slot >= next.size()) {
+            prev.resize(slot + 1, 0);
+            next.resize(slot + 1, 0);
+        }
+        prev[slot] = prev[at];
+        next[slot] = at;
+        next[prev[at]] = slot;
+        prev[at] = slot;
+    }
+    uint64_t end() const { return END; }
+};
+
+const uint64_t FrameList::END;
+
+class FifoReplacer : public PageReplacer {
+private:
+    FrameList order;
+
+public:
+    FifoReplacer() {}
+    void on_load(uint64_t frame, uint16_t, uint64_t) override { order.push_back(frame); }
+    void on_access(uint64_t) override {}
+    uint64_t select_victim() override {
+        uint64_t victim = order.front();
+        int skipped = 0;
+        while (!order.at_end(victim) && skip_dirty(victim, skipped)) victim = order.after(victim);
+        if (order.at_end(victim)) victim = order.front();
+        order.remove(victim);
+        return victim;
+    }
+};
+
+class LruReplacer : public PageReplacer {
+private:
+    FrameList order;        // Least recently used first
+
+public:
+    LruReplacer() {}
+    void on_load(uint64_t frame, uint16_t, uint64_t) override { order.push_back(frame); }
+    void on_access(uint64_t frame) override { order.move_to_back(frame); }
+    uint64_t select_victim() override {
+        uint64_t victim = order.front();
+        int skipped = 0;
+        while (!order.at_end(victim) && skip_dirty(victim, skipped)) victim = order.after(victim);
+        if (order.at_end(victim)) victim = order.front();
+        order.remove(victim);
+        return victim;
+    }
+};
+
+// The frames form a ring (the list read circularly, sentinel skipped) that
+// the hand sweeps, clearing reference bits until it finds one already
+// clear. A new page takes the place just behind the hand, so once every
+// frame is loaded the sweep is in frame order. Only frames this replacer
+// was given are on the ring, so one instance can serve one process.
+class ClockReplacer : public PageReplacer {
+private:
+    FrameList ring;
+    vector<uint8_t> referenced;
+    uint64_t hand;              // ring.end() stands for the front
+
+public:
+    ClockReplacer() : hand(ring.end()) {}
+    void on_load(uint64_t frame, uint16_t, uint64_t) override {
+        if (frame >= referenced.size()) referenced.resize(frame + 1, 0);
+        referenced[frame] = 1;
+        ring.insert_before(frame, hand);
+    }
+    void on_access(uint64_t frame) override { referenced[frame] = 1; }
+    uint64_t select_victim() override {
+        int skipped = 0;
+        if (ring.at_end(hand)) hand = ring.front();
+        while (referenced[hand] || skip_dirty(hand, skipped)) {
+            referenced[hand] = 0;
+            hand = ring.after(hand);
+            if (ring.at_end(hand)) hand = ring.front();
+        }
+        uint64_t victim = hand;
+        hand = ring.after(victim);
+        ring.remove(victim);
+        return victim;
+    }
+};
+
+// Second chance keeps the FIFO list and moves a referenced head to the
+// back instead of evicting it. It picks the same victims as CLOCK; the
+// difference is that pages stay in load order rather than frame order.
+class SecondChanceReplacer : public PageReplacer {
+private:
+    FrameList order;
+    vector<uint8_t> referenced;
+
+public:
+    SecondChanceReplacer() {}
+    void on_load(uint64_t frame, uint16_t, uint64_t) override {
+        if (frame >= referenced.size()) referenced.resize(frame + 1, 0);
+        referenced[frame] = 1;
+        order.push_back(frame);
+    }
+    void on_access(uint64_t frame) override { referenced[frame] = 1; }
+    uint64_t select_victim() override {
+        uint64_t victim = order.front();
+        int skipped = 0;
+        for (;;) {
+            if (order.at_end(victim)) {
+                victim = order.front();
+            } else if (referenced[victim]) {
+                uint64_t next = order.after(victim);
+                referenced[victim] = 0;
+                order.move_to_back(victim);
+                victim = next;
+            } else if (skip_dirty(victim, skipped)) {
+                victim = order.after(victim);
+            } else {
+                break;
+            }
+        }
+        order.remove(victim);
+        return victim;
+    }
+};
+
+// CLOCK-Pro: one clock holds resident hot pages, resident cold pages and
+// up to num_frames non-resident cold pages still in their test period.
+// A cold page re-referenced during its test period becomes hot; the cold
+// allotment grows when that happens after a fault and shrinks when a test
+// period runs out unused. Three hands do the work:
+//   cold  finds the eviction victim among resident cold pages
+//   hot   demotes unreferenced hot pages once hot pages exceed their share
+//   test  retires the oldest non-resident entries
+class ClockProReplacer : public PageReplacer {
+private:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+
+    // A page of one process; the global replacer sees every process's pages
+    struct PageId {
+        uint16_t pid;
+        uint64_t page;
+        bool operator==(const PageId& other) const { return pid == other.pid && page == other.page; }
+    };
+    struct PageIdHash {
+        size_t operator()(const PageId& id) const {
+            return hash<uint64_t>()(id.page * 0x9E3779B97F4A7C15ull ^ id.pid);
+        }
+    };
+
+    struct Node {
+        PageId page;
+        uint64_t frame;
+        uint32_t prev;
+        uint32_t next;
+        bool hot;
+        bool resident;
+        bool test;
+        bool referenced;
+    };
+
+    uint64_t num_frames;
+    vector<Node> nodes;
+    vector<uint32_t> free_nodes;
+    vector<uint32_t> frame_node;
+    unordered_map<PageId, uint32_t, PageIdHash> non_resident;     // Page -> node
+
+    uint32_t hand_hot;
+    uint32_t hand_cold;
+    uint32_t hand_test;
+
+    uint64_t cold_target;
+    uint64_t hot_count;
+    uint64_t cold_count;        // Resident cold pages
+
+    // Nodes are made as the clock first needs them and recycled after
+    uint32_t new_node(const PageId& page, uint64_t frame, bool hot) {
+        uint32_t n;
+        if (free_nodes.empty()) {
+            n = (uint32_t)nodes.size();
+            nodes.push_back(Node());
+        } else {
+            n = free_nodes.back();
+            free_nodes.pop_back();
+        }
+        nodes[n] = {page, frame, n, n, hot, true, !hot, false};
+        return n;
+    }
+
+    // New and promoted pages enter just behind the hot hand, the list head
+    void insert_at_head(uint32_t n) {
+        if (hand_hot == NONE) {
+            nodes[n].prev = nodes[n].next = n;
+            hand_hot = hand_cold = hand_test = n;
+            return;
+        }
+        uint32_t after = nodes[hand_hot].prev;
+        nodes[n].prev = after;
+        nodes[n].next = hand_hot;
+        nodes[after].next = n;
+        nodes[hand_hot].prev = n;
+    }
+
+    void unlink(uint32_t n) {
+        uint32_t next = (nodes[n].next == n) ? NONE : nodes[n].next;
+        if (hand_hot == n) hand_hot = next;
+        if (hand_cold == n) hand_cold = next;
+        if (hand_test == n) hand_test = next;
+        nodes[nodes[n].prev].next = nodes[n].next;
+        nodes[nodes[n].next].prev = nodes[n].prev;
+    }
+
+    void move_to_head(uint32_t n) {
+        unlink(n);
+        insert_at_head(n);
+    }
+
+    void forget(uint32_t n) {
+        unlink(n);
+        non_resident.erase(nodes[n].page);
+        free_nodes.push_back(n);
+    }
+
+    void shrink_cold_target() { if (cold_target > 1) cold_target--; }
+    void grow_cold_target() { if (cold_target + 1 < num_frames) cold_target++; }
+
+    // Ends a cold page's test period; a non-resident page leaves the clock
+    void end_test(uint32_t n) {
+        nodes[n].test = false;
+        shrink_cold_target();
+        if (!nodes[n].resident) forget(n);
+    }
+
+    void run_hand_hot() {
+        for (;;) {
+            uint32_t n = hand_hot;
+            Node& node = nodes[n];
+            if (node.hot) {
+                hand_hot = node.next;
+                if (node.referenced) {
+                    node.referenced = false;
+                } else {
+                    node.hot = false;
+                    hot_count--;
+                    cold_count++;
+                    return;
+                }
+            } else {
+                hand_hot = node.next;
+                if (node.test) end_test(n);
+            }
+        }
+    }
+
+    void run_hand_test() {
+        for (;;) {
+            uint32_t n = hand_test;
+            Node& node = nodes[n];
+            hand_test = node.next;
+            if (!node.hot && node.test) {
+                bool resident = node.resident;
+                end_test(n);
+                if (!resident) return;
+            }
+        }
+    }
+
+    void balance_hot() {
+        if (hot_count > num_frames - cold_target || cold_count == 0) run_hand_hot();
+    }
+
+public:
+    ClockProReplacer(uint64_t frames)
+        : num_frames(frames), hand_hot(NONE), hand_cold(NONE), hand_test(NONE),
+          cold_target(1), hot_count(0), cold_count(0) {}
+
+    void on_load(uint64_t frame, uint16_t pid, uint64_t vpage) override {
+        PageId page = {pid, vpage};
+        auto it = non_resident.find(page);
+        uint32_t n;
+        if (it != non_resident.end()) {
+            // Re-faulted within its test period: it deserved to stay, so the
+            // cold share grows and the page comes back hot
+            forget(it->second);
+            grow_cold_target();
+            n = new_node(page, frame, true);
+            hot_count++;
+        } else {
+            n = new_node(page, frame, false);
+            cold_count++;
+        }
+        if (frame >= frame_node.size()) frame_node.resize(frame + 1, NONE);
+        frame_node[frame] = n;
+        insert_at_head(n);
+        if (nodes[n].hot) balance_hot();
+        while (non_resident.size() > num_frames) run_hand_test();
+    }
+
+    void on_access(uint64_t frame) override { nodes[frame_node[frame]].referenced = true; }
+
+    uint64_t select_victim() override {
+        if (cold_count == 0) run_hand_hot();
+        int skipped = 0;
+        for (;;) {
+            uint32_t n = hand_cold;
+            Node& node = nodes[n];
+            if (node.hot || !node.resident) {
+                hand_cold = node.next;
+                continue;
+            }
+            if (node.referenced) {
+                node.referenced = false;
+                if (node.test) {
+                    // Reused within its test period: promote
+                    node.hot = true;
+                    node.test = false;
+                    cold_count--;
+                    hot_count++;
+                    move_to_head(n);
+                    balance_hot();
+                } else {
+                    node.test = true;
+                    move_to_head(n);
+                }
+                continue;
+            }
+
+            // Unreferenced cold page: evict it, remembering it while its
+            // test period lasts
+            hand_cold = node.next;
+            if (skip_dirty(node.frame, skipped)) continue;
+            uint64_t frame = node.frame;
+            cold_count--;
+            frame_node[frame] = NONE;
+            if (node.test) {
+                node.resident = false;
+                non_resident[node.page] = n;
+            } else {
+                unlink(n);
+                free_nodes.push_back(n);
+            }
+            return frame;
+        }
+    }
+};
+
+const uint32_t ClockProReplacer::NONE;
+
+static const char* const PAGE_POLICY_NAMES[] = { "FIFO", "LRU", "CLOCK", "SECOND-CHANCE", "CLOCK-PRO" };
+
+bool PageReplacer::parse_policy(const string& text, PagePolicy& policy) {
+    string upper = text;
+    for (auto& c : upper) c = (char)toupper((unsigned char)c);
+    if (upper == "SC") upper = "SECOND-CHANCE";
+    if (upper == "CLOCKPRO") upper = "CLOCK-PRO";
+
+    for (int p = PAGE_FIFO; p <= PAGE_CLOCK_PRO; p++) {
+        if (upper == PAGE_POLICY_NAMES[p]) {
+            policy = (PagePolicy)p;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* PageReplacer::policy_name(PagePolicy policy) {
+    return PAGE_POLICY_NAMES[policy];
+}
+
+PageReplacer* PageReplacer::create(PagePolicy policy, uint64_t num_frames) {
+    switch (policy) {
+        case PAGE_FIFO: return new FifoReplacer();
+        case PAGE_LRU: return new LruReplacer();
+        case PAGE_CLOCK: return new ClockReplacer();
+        case PAGE_SECOND_CHANCE: return new SecondChanceReplacer();
+        case PAGE_CLOCK_PRO: return new ClockProReplacer(num_frames);
+    }
+    return nullptr;
+}
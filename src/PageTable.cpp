@@ -0,0 +1,150 @@
+#include "../include/PageTable.h"
+
+const uint32_t PageTable::NO_TABLE;
+const uint32_t PageTable::HUGE_ENTRY;
+const int PageTable::MAX_LEVEL_BITS;
+const int PageTable::PTE_BYTES;
+
+const char* PageTable::geometry_error(int page_number_bits, int levels) {
+    if (levels < 2 || levels > 4) return "page table needs 2-4 levels";
+    if (page_number_bits < levels) return "virtual address space too small for that many levels";
+    if ((page_number_bits + levels - 1) / levels > MAX_LEVEL_BITS) return "too few levels: a table would exceed 64 Ki entries";
+    return nullptr;
+}
+
+PageTable::PageTable(int page_number_bits, int lv, uint64_t base)
+    : levels(lv), table_base(base), walks(0), walk_refs(0) {
+    level_bits.assign(levels, page_number_bits / levels);
+    level_bits[0] += page_number_bits % levels;
+
+    level_shift.assign(levels, 0);
+    for (int l = levels - 2; l >= 0; l--) level_shift[l] = level_shift[l + 1] + level_bits[l + 1];
+
+    int widest = 0;
+    for (int l = 0; l < levels; l++) if (level_bits[l] > widest) widest = level_bits[l];
+    table_stride = (uint64_t)PTE_BYTES << widest;
+
+    new_directory(0);   // The root always exists
+    last_walk.reserve(levels);
+}
+
+uint32_t PageTable::new_directory(int level) {
+    directories.push_back(std::vector<uint32_t>((size_t)1 << level_bits[level], NO_TABLE));
+    directory_address.push_back(table_base + table_pages() * table_stride - table_stride);
+    return (uint32_t)(directories.size() - 1);
+}
+
+uint32_t PageTable::new_leaf() {
+    PageTableEntry empty = {false, 0};
+    leaves.push_back(std::vector<PageTableEntry>((size_t)1 << level_bits[levels - 1], empty));
+    leaf_address.push_back(table_base + table_pages() * table_stride - table_stride);
+    return (uint32_t)(leaves.size() - 1);
+}
+
+uint64_t PageTable::table_bytes() const {
+    uint64_t bytes = 0;
+    for (const auto& d : directories) bytes += d.size() * PTE_BYTES;
+    for (const auto& l : leaves) bytes += l.size() * PTE_BYTES;
+    return bytes;
+}
+
+PageTableEntry* PageTable::walk(uint64_t page, int* order) {
+    walks++;
+
+    uint32_t table = 0;
+    for (int l = 0; l < levels - 1; l++) {
+        int index = index_at(page, l);
+        last_walk.push_back(directory_address[table] + (uint64_t)index * PTE_BYTES);
+        walk_refs++;
+        table = directories[table][index];
+        if (table == NO_TABLE) return nullptr;
+        if (is_huge(table)) {
+            if (order) *order = levels - 1 - l;
+            return &huge_pages[table & ~HUGE_ENTRY];
+        }
+    }
+    int index = index_at(page, levels - 1);
+    last_walk.push_back(leaf_address[table] + (uint64_t)index * PTE_BYTES);
+    walk_refs++;
+
+    PageTableEntry& pte = leaves[table][index];
+    if (order) *order = 0;
+    return pte.valid ? &pte : nullptr;
+}
+
+PageTableEntry* PageTable::find(uint64_t page, int* order) {
+    uint32_t table = 0;
+    for (int l = 0; l < levels - 1; l++) {
+        table = directories[table][index_at(page, l)];
+        if (table == NO_TABLE) return nullptr;
+        if (is_huge(table)) {
+            if (order) *order = levels - 1 - l;
+            return &huge_pages[table & ~HUGE_ENTRY];
+        }
+    }
+    if (order) *order = 0;
+    return &leaves[table][index_at(page, levels - 1)];
+}
+
+// Puts back the table a huge entry replaced
+void PageTable::unmap_huge_entry(uint32_t& entry) {
+    uint32_t id = entry & ~HUGE_ENTRY;
+    entry = huge_child[id];
+    free_huge.push_back(id);
+}
+
+PageTableEntry& PageTable::map(uint64_t page) {
+    uint32_t table = 0;
+    for (int l = 0; l < levels - 1; l++) {
+        int index = index_at(page, l);
+        if (is_huge(directories[table][index])) unmap_huge_entry(directories[table][index]);
+        if (directories[table][index] == NO_TABLE) {
+            // Allocating may reallocate the pool, so re-index afterwards
+            uint32_t child = (l + 1 < levels - 1) ? new_directory(l + 1) : new_leaf();
+            directories[table][index] = child;
+        }
+        table = directories[table][index];
+    }
+    return leaves[table][index_at(page, levels - 1)];
+}
+
+PageTableEntry& PageTable::map_huge(uint64_t page, int order) {
+    int target = levels - 1 - order;
+    uint32_t table = 0;
+    for (int l = 0; l < target; l++) {
+        int index = index_at(page, l);
+        if (is_huge(directories[table][index])) unmap_huge_entry(directories[table][index]);
+        if (directories[table][index] == NO_TABLE) {
+            uint32_t child = new_directory(l + 1);
+            directories[table][index] = child;
+        }
+        table = directories[table][index];
+    }
+
+    uint32_t& entry = directories[table][index_at(page, target)];
+    if (!is_huge(entry)) {
+        uint32_t id;
+        if (free_huge.empty()) {
+            id = (uint32_t)huge_pages.size();
+            huge_pages.push_back(PageTableEntry());
+            huge_child.push_back(entry);
+        } else {
+            id = free_huge.back();
+            free_huge.pop_back();
+            huge_child[id] = entry;
+        }
+        entry = HUGE_ENTRY | id;
+    }
+    return huge_pages[entry & ~HUGE_ENTRY];
+}
+
+void PageTable::split_huge(uint64_t page, int order) {
+    int target = levels - 1 - order;
+    uint32_t table = 0;
+    for (int l = 0; l < target; l++) {
+        table = directories[table][index_at(page, l)];
+        if (table == NO_TABLE || is_huge(table)) return;
+    }
+    uint32_t& entry = directories[table][index_at(page, target)];
+    if (is_huge(entry)) unmap_huge_entry(entry);
+}
@@ -0,0 +1,126 @@
+#include "../include/ParallelCacheSim.h"
+#include "../include/CacheEngine.h"
+#include <algorithm>
+
+const size_t ParallelCacheSim::BATCH_REFS;
+
+ParallelCacheSim* ParallelCacheSim::create(const CacheShape shapes[3], int threads, const char*& error) {
+    int shift = 0;
+    for (int l = 0; l < 3; l++) {
+        const CacheShape& s = shapes[l];
+        size_t sets = s.size / (s.blockSize * s.assoc);
+        if (!isPowerOfTwo(s.blockSize) || !isPowerOfTwo(sets)) {
+            error = "every level needs a power-of-two block size and set count";
+            return nullptr;
+        }
+        if (s.policy == POLICY_BRRIP || s.policy == POLICY_RANDOM) {
+            error = "BRRIP and RANDOM draw from one random stream per level, which does not split";
+            return nullptr;
+        }
+        shift = std::max(shift, log2Exact(s.blockSize));
+    }
+
+    // The shard bits must sit inside every level's set index
+    int room = 64;
+    for (int l = 0; l < 3; l++) {
+        const CacheShape& s = shapes[l];
+        int indexTop = log2Exact(s.size / s.assoc);     // Block offset plus set index bits
+        room = std::min(room, indexTop - shift);
+    }
+    if (room <= 0) {
+        error = "a level has too few sets to split";
+        return nullptr;
+    }
+
+    // A few shards per thread even out sets that see more traffic
+    int bits = 0;
+    while (bits < room && (1 << bits) < 4 * threads) bits++;
+    return new ParallelCacheSim(shapes, shift, bits, std::min(threads, 1 << bits));
+}
+
+ParallelCacheSim::ParallelCacheSim(const CacheShape shapes[3], int shift, int bits, int threads)
+    : shardShift(shift), shardBits(bits), shardMask(((uint64_t)1 << bits) - 1),
+      lowMask(((uint64_t)1 << shift) - 1), shards((size_t)1 << bits), queued(0),
+      generation(0), busy(0), stopping(false) {
+    static const char* const NAMES[3] = { "L1", "L2", "L3" };
+    for (auto& shard : shards) {
+        for (int l = 0; l < 3; l++) {
+            const CacheShape& s = shapes[l];
+            shard.levels[l] = CacheLevel::create(NAMES[l], s.size >> bits, s.blockSize, s.assoc, s.policy, s.seed);
+        }
+        shard.filling.reserve(2 * BATCH_REFS / shards.size());
+        shard.working.reserve(2 * BATCH_REFS / shards.size());
+        shard.accessCycles = 0;
+        shard.walkCycles = 0;
+    }
+    for (int t = 0; t < threads; t++) workers.push_back(std::thread(&ParallelCacheSim::workerLoop, this, t));
+}
+
+ParallelCacheSim::~ParallelCacheSim() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+    for (auto& shard : shards) {
+        for (int l = 0; l < 3; l++) delete shard.levels[l];
+    }
+}
+
+void ParallelCacheSim::waitIdle() {
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this] { return busy == 0; });
+}
+
+// Hands the filled batch to the workers once they are done with the last
+void ParallelCacheSim::dispatch() {
+    waitIdle();
+    for (auto& shard : shards) std::swap(shard.filling, shard.working);
+    queued = 0;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        busy = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+}
+
+void ParallelCacheSim::workerLoop(int id) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (generation == seen) return;
+            seen = generation;
+        }
+
+        for (size_t k = id; k < shards.size(); k += workers.size()) {
+            Shard& shard = shards[k];
+            for (const Ref& ref : shard.working) {
+                int cost = CacheController::lookupLevels(shard.levels[0], shard.levels[1], shard.levels[2],
+                                                         ref.address, ref.isWrite);
+                if (ref.pageWalk) shard.walkCycles += cost;
+                else shard.accessCycles += cost;
+            }
+            shard.working.clear();
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (--busy == 0) idle.notify_one();
+    }
+}
+
+void ParallelCacheSim::drain(CacheLevel* levels[3], unsigned long long& accessCycles,
+                             unsigned long long& walkCycles) {
+    dispatch();
+    waitIdle();
+    for (auto& shard : shards) {
+        for (int l = 0; l < 3; l++) levels[l]->takeStats(*shard.levels[l]);
+        accessCycles += shard.accessCycles;
+        walkCycles += shard.walkCycles;
+        shard.accessCycles = 0;
+        shard.walkCycles = 0;
+    }
+}
@@ -0,0 +1,293 @@
+#include "../include/Prefetcher.h"
+#include <cctype>
+
+const size_t Prefetcher::IN_FLIGHT;
+const size_t Prefetcher::DISPLACED;
+
+// ---------------- Next-line ----------------
+
+// Tagged next-line: a miss, or the first use of a line it prefetched,
+// fetches degree lines starting distance lines on
+class NextLinePrefetcher : public Prefetcher {
+public:
+    explicit NextLinePrefetcher(const PrefetchConfig& config) : Prefetcher(config) {}
+
+    void train(uint64_t line, bool miss, bool prefetchHit, std::vector<uint64_t>& out) override {
+        if (!miss && !prefetchHit) return;
+        for (int i = 0; i < config.degree; i++) out.push_back(line + config.distance + i);
+    }
+};
+
+// ---------------- Stride ----------------
+
+// Without a PC to key on, references are grouped by 4 KiB-sized region of
+// lines: each region's entry holds its last line and the delta seen
+// between them. Once the same delta repeats, the next degree strides from
+// distance strides ahead are fetched.
+class StridePrefetcher : public Prefetcher {
+private:
+    static const int REGION_SHIFT = 6;          // 64 lines per region
+    static const size_t ENTRIES = 64;           // Direct-mapped by region
+    static const int CONFIDENT = 1;             // Repeats of a delta before it is trusted
+    static const int MAX_CONFIDENCE = 3;
+
+    struct Entry {
+        uint64_t region;
+        uint64_t lastLine;
+        int64_t stride;
+        int confidence;
+        bool valid;
+    };
+    std::vector<Entry> table;
+
+public:
+    explicit StridePrefetcher(const PrefetchConfig& config) : Prefetcher(config), table(ENTRIES, Entry()) {}
+
+    void train(uint64_t line, bool, bool, std::vector<uint64_t>& out) override {
+        uint64_t region = line >> REGION_SHIFT;
+        Entry& e = table[region & (ENTRIES - 1)];
+        if (!e.valid || e.region != region) {
+            e = {region, line, 0, 0, true};
+            return;
+        }
+        int64_t delta = (int64_t)(line - e.lastLine);
+        if (delta == 0) return;
+        if (delta == e.stride) {
+            if (e.confidence < MAX_CONFIDENCE) e.confidence++;
+        } else {
+            e.stride = delta;
+            e.confidence = 0;
+        }
+        e.lastLine = line;
+        if (e.confidence < CONFIDENT) return;
+
+        for (int i = 0; i < config.degree; i++) {
+            int64_t target = (int64_t)line + e.stride * (config.distance + i);
+            if (target < 0) break;
+            out.push_back((uint64_t)target);
+        }
+    }
+};
+
+// ---------------- Stream buffers ----------------
+
+// A miss that no stream expects opens one (the least recently used) in the
+// direction of the previous miss, if it was the neighbouring line. Demand
+// reaching into a stream's window moves its head; the stream then tops up,
+// at most degree lines at a time, until it runs distance lines ahead.
+class StreamPrefetcher : public Prefetcher {
+private:
+    static const size_t STREAMS = 8;
+
+    struct Stream {
+        uint64_t head;          // Next line demand is expected on
+        uint64_t next;          // Next line to prefetch
+        int64_t dir;            // +1 or -1
+        uint64_t lastUse;
+        bool valid;
+    };
+    std::vector<Stream> streams;
+    uint64_t clock;
+    uint64_t lastMiss;
+
+    // Lines prefetched ahead of the head
+    static int64_t ahead(const Stream& s) { return (int64_t)(s.next - s.head) * s.dir; }
+
+    void topUp(Stream& s, std::vector<uint64_t>& out) {
+        for (int i = 0; i < config.degree && ahead(s) < config.distance; i++) {
+            if (s.dir < 0 && s.next == 0) break;
+            out.push_back(s.next);
+            s.next += s.dir;
+        }
+    }
+
+public:
+    explicit StreamPrefetcher(const PrefetchConfig& config)
+        : Prefetcher(config), streams(STREAMS, Stream()), clock(0), lastMiss(UINT64_MAX) {}
+
+    void train(uint64_t line, bool miss, bool, std::vector<uint64_t>& out) override {
+        clock++;
+        for (auto& s : streams) {
+            if (!s.valid) continue;
+            // Within the window, or on its far edge when demand outran it
+            int64_t offset = (int64_t)(line - s.head) * s.dir;
+            if (offset < 0 || offset > ahead(s)) continue;
+            s.head = line + s.dir;
+            if (ahead(s) < 0) s.next = s.head;
+            s.lastUse = clock;
+            topUp(s, out);
+            return;
+        }
+        if (!miss) return;
+
+        Stream* oldest = &streams[0];
+        for (auto& s : streams) {
+            if (!s.valid) {
+                oldest = &s;
+                break;
+            }
+            if (s.lastUse < oldest->lastUse) oldest = &s;
+        }
+        int64_t dir = (lastMiss == line + 1) ? -1 : 1;
+        lastMiss = line;
+        if (dir < 0 && line == 0) return;
+        *oldest = {line + dir, line + dir, dir, clock, true};
+        topUp(*oldest, out);
+    }
+};
+
+// ---------------- Spatial ----------------
+
+// Spatial footprints without a PC: the lines touched in a region during a
+// generation are recorded, and when the generation ends its footprint is
+// stored under the offset of the line that opened it. A generation ends
+// when the region drops out of the active table, or when demand misses on
+// a line it already touched (its data has left the cache) and a new one
+// opens there. Opening a generation fetches the footprint stored for its
+// offset, up to degree lines, nearest the trigger first.
+class SpatialPrefetcher : public Prefetcher {
+private:
+    static const size_t ACTIVE = 16;
+
+    struct Region {
+        uint64_t region;
+        uint64_t footprint;     // One bit per line
+        uint64_t lastUse;
+        int trigger;
+        bool valid;
+    };
+    std::vector<Region> active;
+    std::vector<uint64_t> patterns;     // Footprint by trigger offset
+    uint64_t clock;
+
+public:
+    explicit SpatialPrefetcher(const PrefetchConfig& config)
+        : Prefetcher(config), active(ACTIVE, Region()), patterns(config.distance, 0), clock(0) {}
+
+    void train(uint64_t line, bool miss, bool, std::vector<uint64_t>& out) override {
+        clock++;
+        uint64_t lines = (uint64_t)config.distance;
+        uint64_t region = line / lines;
+        int offset = (int)(line % lines);
+        uint64_t bit = (uint64_t)1 << offset;
+
+        Region* ending = &active[0];
+        for (auto& r : active) {
+            if (r.valid && r.region == region) {
+                if (!miss || !(r.footprint & bit)) {
+                    r.footprint |= bit;
+                    r.lastUse = clock;
+                    return;
+                }
+                ending = &r;
+                break;
+            }
+            if (ending->valid && (!r.valid || r.lastUse < ending->lastUse)) ending = &r;
+        }
+        if (ending->valid) patterns[ending->trigger] = ending->footprint;
+        *ending = {region, bit, clock, offset, true};
+
+        uint64_t pattern = patterns[offset] & ~bit;
+        int proposed = 0;
+        for (int d = 1; d < (int)lines && pattern && proposed < config.degree; d++) {
+            int sides[2] = {offset + d, offset - d};
+            for (int o : sides) {
+                if (o < 0 || o >= (int)lines || !(pattern & ((uint64_t)1 << o))) continue;
+                pattern &= ~((uint64_t)1 << o);
+                out.push_back(region * lines + o);
+                if (++proposed == config.degree) break;
+            }
+        }
+    }
+};
+
+// ---------------- Prefetcher ----------------
+
+Prefetcher::Prefetcher(const PrefetchConfig& cfg)
+    : inFlight(IN_FLIGHT, InFlight()), inFlightNext(0), displaced(DISPLACED, 0), counts(), config(cfg) {}
+
+static const char* const KIND_NAMES[] = { "off", "next-line", "stride", "stream", "spatial" };
+
+bool Prefetcher::parseKind(const std::string& text, PrefetcherKind& kind) {
+    std::string lower = text;
+    for (auto& c : lower) c = (char)tolower((unsigned char)c);
+    if (lower == "nextline" || lower == "next") lower = "next-line";
+    if (lower == "region") lower = "spatial";
+
+    for (int k = PREFETCH_OFF; k <= PREFETCH_SPATIAL; k++) {
+        if (lower == KIND_NAMES[k]) {
+            kind = (PrefetcherKind)k;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* Prefetcher::kindName(PrefetcherKind kind) {
+    return KIND_NAMES[kind];
+}
+
+PrefetchConfig Prefetcher::defaults(PrefetcherKind kind) {
+    switch (kind) {
+        case PREFETCH_STRIDE: return {kind, 2, 1};
+        case PREFETCH_STREAM: return {kind, 2, 8};
+        case PREFETCH_SPATIAL: return {kind, 32, 32};
+        default: return {kind, 1, 1};
+    }
+}
+
+const char* Prefetcher::configError(const PrefetchConfig& config) {
+    if (config.kind == PREFETCH_OFF) return nullptr;
+    if (config.degree < 1 || config.degree > 64) return "degree must be 1..64";
+    if (config.kind == PREFETCH_SPATIAL) {
+        if (config.distance < 2 || config.distance > 64 || (config.distance & (config.distance - 1))) {
+            return "spatial region must be a power of two of 2..64 lines";
+        }
+    } else if (config.distance < 1 || config.distance > 1024) {
+        return "distance must be 1..1024";
+    }
+    return nullptr;
+}
+
+Prefetcher* Prefetcher::create(const PrefetchConfig& config) {
+    switch (config.kind) {
+        case PREFETCH_OFF: return nullptr;
+        case PREFETCH_NEXT_LINE: return new NextLinePrefetcher(config);
+        case PREFETCH_STRIDE: return new StridePrefetcher(config);
+        case PREFETCH_STREAM: return new StreamPrefetcher(config);
+        case PREFETCH_SPATIAL: return new SpatialPrefetcher(config);
+    }
+    return nullptr;
+}
+
+void Prefetcher::issued(uint64_t line, uint64_t ready) {
+    counts.issued++;
+    inFlight[inFlightNext] = {line + 1, ready};
+    inFlightNext = (inFlightNext + 1) % IN_FLIGHT;
+    uint64_t& slot = displaced[line % DISPLACED];
+    if (slot == line + 1) slot = 0;
+}
+
+uint64_t Prefetcher::used(uint64_t line, uint64_t now) {
+    counts.useful++;
+    for (auto& f : inFlight) {
+        if (f.line != line + 1) continue;
+        f.line = 0;
+        if (f.ready <= now) return 0;
+        counts.late++;
+        return f.ready - now;
+    }
+    return 0;
+}
+
+void Prefetcher::displacedLine(uint64_t line) {
+    counts.evictions++;
+    displaced[line % DISPLACED] = line + 1;
+}
+
+void Prefetcher::demandMiss(uint64_t line) {
+    uint64_t& slot = displaced[line % DISPLACED];
+    if (slot != line + 1) return;
+    slot = 0;
+    counts.pollution++;
+}
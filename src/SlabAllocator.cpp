@@ -0,0 +1,314 @@
+#include "../include/SlabAllocator.h"
+#include "../include/BitOps.h"
+#include "../include/EventLog.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+const size_t SlabAllocator::DEFAULT_SLAB_SIZE;
+const size_t SlabAllocator::MIN_CLASS_SIZE;
+const int SlabAllocator::EMPTY_SLABS_KEPT;
+const int SlabAllocator::NONE;
+
+SlabAllocator::SlabAllocator(size_t size)
+    : MemoryManager(size), largeBytes(0), largeBlocks(0), reclaimedSlabs(0) {
+    this->allocatorType = "slab";
+
+    // Small heaps get smaller slabs so that there is room for several
+    slabSize = DEFAULT_SLAB_SIZE;
+    while (slabSize > 64 && slabSize * 16 > size) slabSize /= 2;
+
+    // Power-of-two classes, each slab holding at least four objects
+    for (size_t objSize = MIN_CLASS_SIZE; objSize * 4 <= slabSize; objSize *= 2) {
+        SizeClass sc;
+        sc.objectSize = objSize;
+        sc.objectsPerSlab = (int)(slabSize / objSize);
+        for (int l = 0; l < SLAB_LIST_COUNT; l++) {
+            sc.heads[l] = NONE;
+            sc.counts[l] = 0;
+        }
+        sc.liveObjects = 0;
+        sc.waste = 0;
+        sc.slabsCreated = 0;
+        sc.slabsReleased = 0;
+        classes.push_back(sc);
+    }
+
+    MEMSIM_LOG(std::cout << "[Slab] Initialized. Size: " << totalMemorySize << " bytes, slab "
+              << slabSize << " bytes, " << classes.size() << " size classes" << std::endl);
+}
+
+int SlabAllocator::classFor(size_t size) const {
+    for (size_t c = 0; c < classes.size(); c++) {
+        if (size <= classes[c].objectSize) return (int)c;
+    }
+    return NONE;
+}
+
+// ---------------- Slab lists ----------------
+
+void SlabAllocator::linkSlab(int s, int list) {
+    SizeClass& sc = classes[slabs[s].sizeClass];
+    slabs[s].list = list;
+    slabs[s].prev = NONE;
+    slabs[s].next = sc.heads[list];
+    if (sc.heads[list] != NONE) slabs[sc.heads[list]].prev = s;
+    sc.heads[list] = s;
+    sc.counts[list]++;
+}
+
+void SlabAllocator::unlinkSlab(int s) {
+    Slab& slab = slabs[s];
+    SizeClass& sc = classes[slab.sizeClass];
+    if (slab.prev != NONE) slabs[slab.prev].next = slab.next;
+    else sc.heads[slab.list] = slab.next;
+    if (slab.next != NONE) slabs[slab.next].prev = slab.prev;
+    sc.counts[slab.list]--;
+}
+
+// ---------------- Backing memory ----------------
+
+MemoryManager::BlockIter SlabAllocator::carveWithReclaim(size_t size) {
+    BlockIter block = carveBlock(size, 0);
+    if (block == memoryList.end() && reclaimEmptySlabs() > 0) {
+        block = carveBlock(size, 0);
+    }
+    return block;
+}
+
+int SlabAllocator::newSlab(int cls) {
+    BlockIter block = carveWithReclaim(slabSize);
+    if (block == memoryList.end()) return NONE;
+
+    int s;
+    if (!spareSlabs.empty()) {
+        s = spareSlabs.back();
+        spareSlabs.pop_back();
+    } else {
+        s = (int)slabs.size();
+        slabs.push_back(Slab());
+    }
+
+    Slab& slab = slabs[s];
+    SizeClass& sc = classes[cls];
+    slab.block = block;
+    slab.sizeClass = cls;
+    slab.objects = sc.objectsPerSlab;
+    slab.inUse = 0;
+
+    // All objects start free
+    size_t words = (slab.objects + 63) / 64;
+    slab.freeMap.assign(words, ~(uint64_t)0);
+    if (slab.objects % 64) slab.freeMap[words - 1] = ((uint64_t)1 << (slab.objects % 64)) - 1;
+    slab.summary = (words == 64) ? ~(uint64_t)0 : (((uint64_t)1 << words) - 1);
+
+    slabAt[block->startAddress] = s;
+    sc.slabsCreated++;
+    linkSlab(s, SLAB_EMPTY);
+    return s;
+}
+
+void SlabAllocator::destroySlab(int s) {
+    unlinkSlab(s);
+    classes[slabs[s].sizeClass].slabsReleased++;
+    slabAt.erase(slabs[s].block->startAddress);
+    releaseBlock(slabs[s].block);
+    slabs[s].freeMap.clear();
+    spareSlabs.push_back(s);
+}
+
+// Memory is tight: give every cached empty slab back to the heap
+size_t SlabAllocator::reclaimEmptySlabs() {
+    size_t released = 0;
+    for (size_t c = 0; c < classes.size(); c++) {
+        while (classes[c].heads[SLAB_EMPTY] != NONE) {
+            destroySlab(classes[c].heads[SLAB_EMPTY]);
+            released++;
+        }
+    }
+    reclaimedSlabs += released;
+    if (released > 0) {
+        MEMSIM_LOG(std::cout << "[Slab] Reclaimed " << released << " empty slab(s)" << std::endl);
+    }
+    return released;
+}
+
+size_t SlabAllocator::objectAddress(const ObjectRef& ref) const {
+    if (ref.slab == NONE) return ref.block->startAddress;
+    const Slab& slab = slabs[ref.slab];
+    return slab.block->startAddress + (size_t)ref.index * classes[slab.sizeClass].objectSize;
+}
+
+size_t SlabAllocator::objectBytes(const ObjectRef& ref) const {
+    return ref.slab == NONE ? ref.block->size : classes[slabs[ref.slab].sizeClass].objectSize;
+}
+
+// ---------------- Allocator interface ----------------
+
+bool SlabAllocator::allocate(size_t size) {
+    numAllocRequests++;
+
+    int cls = classFor(size);
+    int id = nextBlockId;
+    ObjectRef ref;
+    ref.requested = size;
+    ref.slab = NONE;
+    ref.index = 0;
+    bool ok = false;
+
+    if (cls == NONE) {
+        // Large object: straight from the heap
+        ref.block = carveWithReclaim(size);
+        if (ref.block != memoryList.end()) {
+            ref.block->id = id;
+            largeBytes += size;
+            largeBlocks++;
+            ok = true;
+        }
+    } else {
+        SizeClass& sc = classes[cls];
+        int s = sc.heads[SLAB_PARTIAL];
+        if (s == NONE) s = sc.heads[SLAB_EMPTY];
+        if (s == NONE) s = newSlab(cls);
+
+        if (s != NONE) {
+            Slab& slab = slabs[s];
+            int word = findFirstSet(slab.summary);
+            int bit = findFirstSet(slab.freeMap[word]);
+            slab.freeMap[word] &= ~((uint64_t)1 << bit);
+            if (!slab.freeMap[word]) slab.summary &= ~((uint64_t)1 << word);
+
+            ref.slab = s;
+            ref.index = word * 64 + bit;
+
+            slab.inUse++;
+            int target = (slab.inUse == slab.objects) ? SLAB_FULL : SLAB_PARTIAL;
+            if (slab.list != target) {
+                unlinkSlab(s);
+                linkSlab(s, target);
+            }
+            sc.liveObjects++;
+            sc.waste += sc.objectSize - size;
+            ok = true;
+        }
+    }
+
+    if (!ok) {
+        MEMSIM_LOG(std::cout << "Error: Not enough memory to allocate " << size << " bytes." << std::endl);
+        MEMSIM_EVENT(EV_ALLOC_FAIL, EVSRC_HEAP, 0, 0, size);
+        numFailedAllocs++;
+        return false;
+    }
+
+    nextBlockId++;
+    objects[id] = ref;
+
+    MEMSIM_LOG(std::cout << "Allocated block id=" << id << " at address=0x" << std::hex << objectAddress(ref) << std::dec;
+               if (cls != NONE) std::cout << " (class " << classes[cls].objectSize << ")";
+               std::cout << std::endl);
+    MEMSIM_EVENT(EV_ALLOC, EVSRC_HEAP, id, objectAddress(ref), objectBytes(ref));
+
+    numSuccessfulAllocs++;
+    return true;
+}
+
+bool SlabAllocator::deallocate(int blockId) {
+    auto found = objects.find(blockId);
+    if (found == objects.end()) {
+        MEMSIM_LOG(std::cout << "Error: Block ID " << blockId << " not found." << std::endl);
+        return false;
+    }
+    ObjectRef ref = found->second;
+    objects.erase(found);
+
+    if (ref.slab == NONE) {
+        MEMSIM_EVENT(EV_FREE, EVSRC_HEAP, blockId, objectAddress(ref), objectBytes(ref));
+        largeBytes -= ref.block->size;
+        largeBlocks--;
+        releaseBlock(ref.block);
+    } else {
+        Slab& slab = slabs[ref.slab];
+        SizeClass& sc = classes[slab.sizeClass];
+        MEMSIM_EVENT(EV_FREE, EVSRC_HEAP, blockId, objectAddress(ref), objectBytes(ref));
+
+        int word = ref.index / 64;
+        slab.freeMap[word] |= (uint64_t)1 << (ref.index % 64);
+        slab.summary |= (uint64_t)1 << word;
+        slab.inUse--;
+        sc.liveObjects--;
+        sc.waste -= sc.objectSize - ref.requested;
+
+        int target = (slab.inUse == 0) ? SLAB_EMPTY : SLAB_PARTIAL;
+        if (slab.list != target) {
+            unlinkSlab(ref.slab);
+            linkSlab(ref.slab, target);
+        }
+        if (target == SLAB_EMPTY && sc.counts[SLAB_EMPTY] > (size_t)EMPTY_SLABS_KEPT) {
+            destroySlab(ref.slab);
+        }
+    }
+
+    MEMSIM_LOG(std::cout << "Block " << blockId << " freed." << std::endl);
+    numFrees++;
+    return true;
+}
+
+void SlabAllocator::dumpMemory() {
+    std::cout << "\n--- Memory Dump (Slab) ---" << std::endl;
+    for (const auto& block : memoryList) {
+        std::cout << "[0x" << std::hex << block.startAddress << "-0x"
+                  << (block.startAddress + block.size - 1) << std::dec << "] ";
+        if (block.isFree) {
+            std::cout << "FREE (" << block.size << " bytes)" << std::endl;
+            continue;
+        }
+        auto slab = slabAt.find(block.startAddress);
+        if (slab != slabAt.end()) {
+            const Slab& s = slabs[slab->second];
+            std::cout << "SLAB (class " << classes[s.sizeClass].objectSize << ", "
+                      << s.inUse << "/" << s.objects << " objects)" << std::endl;
+        } else {
+            std::cout << "USED (ID=" << block.id << ", " << block.size << " bytes)" << std::endl;
+        }
+    }
+    std::cout << "--------------------------\n" << std::endl;
+}
+
+void SlabAllocator::showStats() {
+    size_t usedMemory = largeBytes;
+    size_t usedBlocks = largeBlocks;
+    size_t internalFrag = 0;
+    size_t freeBlocks = 0;
+
+    for (const auto& sc : classes) {
+        usedMemory += sc.liveObjects * sc.objectSize;
+        usedBlocks += sc.liveObjects;
+        internalFrag += sc.waste;
+        size_t slabCount = sc.counts[SLAB_PARTIAL] + sc.counts[SLAB_FULL] + sc.counts[SLAB_EMPTY];
+        freeBlocks += slabCount * sc.objectsPerSlab - sc.liveObjects;
+    }
+    freeBlocks += freeBySize.size();
+
+    // Free object slots are free memory too, but only usable by their class
+    size_t largestFreeBlock = freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+    printSummary(usedMemory, totalMemorySize - usedMemory, usedBlocks, freeBlocks,
+                 internalFrag, largestFreeBlock);
+
+    std::cout << "Slab size: " << slabSize << " bytes, reclaimed slabs: " << reclaimedSlabs << std::endl;
+    std::cout << "Class   Slabs(P/F/E)   Objects      Occupancy   Internal waste" << std::endl;
+    for (const auto& sc : classes) {
+        size_t slabCount = sc.counts[SLAB_PARTIAL] + sc.counts[SLAB_FULL] + sc.counts[SLAB_EMPTY];
+        size_t capacity = slabCount * sc.objectsPerSlab;
+        double occupancy = capacity ? (double)sc.liveObjects / capacity * 100.0 : 0.0;
+        std::ostringstream slabCol, objCol;
+        slabCol << sc.counts[SLAB_PARTIAL] << "/" << sc.counts[SLAB_FULL] << "/" << sc.counts[SLAB_EMPTY];
+        objCol << sc.liveObjects << "/" << capacity;
+        std::cout << std::left << std::setw(8) << sc.objectSize
+                  << std::setw(15) << slabCol.str()
+                  << std::setw(13) << objCol.str()
+                  << std::right << std::setw(8) << std::fixed << std::setprecision(2) << occupancy << "%   "
+                  << sc.waste << " bytes" << std::endl;
+    }
+    std::cout << "Large objects: " << largeBlocks << " (" << largeBytes << " bytes)" << std::endl;
+    std::cout << "---------------------------" << std::endl;
+}
@@ -0,0 +1,52 @@
+#include "../include/SparseMemory.h"
+#include <algorithm>
+#include <cstring>
+
+const uint64_t SparseMemory::CHUNK_SIZE;
+
+void SparseMemory::resize(uint64_t size) {
+    bytes = size;
+    uint64_t lastChunk = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        if (it->first >= lastChunk) it = chunks.erase(it);
+        else ++it;
+    }
+}
+
+void SparseMemory::read(uint64_t address, void* out, size_t length) const {
+    char* dest = static_cast<char*>(out);
+    while (length > 0) {
+        uint64_t offset = address % CHUNK_SIZE;
+        size_t span = (size_t)std::min<uint64_t>(length, CHUNK_SIZE - offset);
+        auto it = address < bytes ? chunks.find(address / CHUNK_SIZE) : chunks.end();
+        if (it == chunks.end()) std::memset(dest, 0, span);
+        else std::memcpy(dest, it->second.data() + offset, span);
+        address += span;
+        dest += span;
+        length -= span;
+    }
+}
+
+void SparseMemory::write(uint64_t address, const void* data, size_t length) {
+    const char* src = static_cast<const char*>(data);
+    while (length > 0 && address < bytes) {
+        uint64_t offset = address % CHUNK_SIZE;
+        size_t span = (size_t)std::min<uint64_t>(length, CHUNK_SIZE - offset);
+        std::vector<char>& chunk = chunks[address / CHUNK_SIZE];
+        if (chunk.empty()) chunk.assign(CHUNK_SIZE, 0);
+        std::memcpy(chunk.data() + offset, src, span);
+        address += span;
+        src += span;
+        length -= span;
+    }
+}
+
+bool SparseMemory::isCommitted(uint64_t address, uint64_t length) const {
+    if (length == 0 || chunks.empty()) return false;
+    uint64_t first = address / CHUNK_SIZE;
+    uint64_t last = (address + length - 1) / CHUNK_SIZE;
+    for (uint64_t chunk = first; chunk <= last; chunk++) {
+        if (chunks.count(chunk)) return true;
+    }
+    return false;
+}
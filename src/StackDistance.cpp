@@ -0,0 +1,128 @@
+#include "../include/StackDistance.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+const uint64_t StackDistance::MIN_SPAN;
+const uint32_t StackDistance::SAMPLE_SPACE;
+
+StackDistance::StackDistance(double rate)
+    : sampleRate(rate >= 1.0 ? 1.0 : rate), tree(MIN_SPAN + 1, 0), now(0), trackedRefs(0), totalRefs(0) {
+    sampleThreshold = (uint32_t)std::ceil(sampleRate * SAMPLE_SPACE);
+}
+
+// SHARDS keeps a key for good or not at all, so its reuses stay whole
+bool StackDistance::tracked(uint64_t key) const {
+    if (sampleRate >= 1.0) return true;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (uint32_t)(key & (SAMPLE_SPACE - 1)) < sampleThreshold;
+}
+
+uint64_t StackDistance::marksUpTo(uint64_t time) const {
+    uint64_t count = 0;
+    for (; time > 0; time &= time - 1) count += tree[time];
+    return count;
+}
+
+void StackDistance::mark(uint64_t time, int delta) {
+    for (; time < tree.size(); time += time & (~time + 1)) tree[time] += delta;
+}
+
+// Gives the live marks the times 1..n in their current order, in a tree
+// with room for a few times as many references again
+void StackDistance::renumber() {
+    std::vector<std::pair<uint64_t, uint64_t>> order;     // (time, key)
+    order.reserve(lastUse.size());
+    for (const auto& entry : lastUse) order.push_back(std::make_pair(entry.second, entry.first));
+    std::sort(order.begin(), order.end());
+
+    uint64_t live = order.size();
+    tree.assign(std::max(MIN_SPAN, 4 * live) + 1, 0);
+    for (uint64_t t = 1; t <= live; t++) {
+        lastUse[order[t - 1].second] = t;
+        tree[t] += 1;
+        uint64_t parent = t + (t & (~t + 1));
+        if (parent < tree.size()) tree[parent] += tree[t];
+    }
+    // Counts of the nodes above the marks still owe them
+    for (uint64_t t = live + 1; t < tree.size(); t++) {
+        uint64_t parent = t + (t & (~t + 1));
+        if (parent < tree.size()) tree[parent] += tree[t];
+    }
+    now = live;
+}
+
+void StackDistance::access(uint64_t key) {
+    totalRefs++;
+    if (!tracked(key)) return;
+    trackedRefs++;
+    if (now + 1 >= tree.size()) renumber();
+    now++;
+
+    auto it = lastUse.find(key);
+    if (it == lastUse.end()) {
+        lastUse[key] = now;
+        mark(now, 1);
+        return;
+    }
+
+    // Every mark after the last use is a distinct key touched since
+    uint64_t distance = lastUse.size() - marksUpTo(it->second);
+    if (distance >= histogram.size()) histogram.resize(distance + 1, 0);
+    histogram[distance]++;
+    mark(it->second, -1);
+    mark(now, 1);
+    it->second = now;
+}
+
+uint64_t StackDistance::distinctKeys() const {
+    return (uint64_t)std::llround(lastUse.size() / sampleRate);
+}
+
+double StackDistance::missRatio(uint64_t capacity) const {
+    if (trackedRefs == 0) return 0.0;
+    uint64_t hits = 0;
+    double reach = capacity * sampleRate;      // Tracked distances below this hit
+    for (uint64_t d = 0; d < histogram.size() && d < reach; d++) hits += histogram[d];
+    return (double)(trackedRefs - hits) / trackedRefs;
+}
+
+uint64_t StackDistance::flatCapacity() const {
+    if (histogram.empty()) return 1;
+    return (uint64_t)std::floor((histogram.size() - 1) / sampleRate) + 1;
+}
+
+void StackDistance::writeCsv(FILE* out, const char* curve, uint64_t itemBytes) const {
+    uint64_t hits = 0;
+    uint64_t d = 0;
+    uint64_t last = flatCapacity();
+    for (uint64_t capacity = 1; capacity <= last; capacity++) {
+        double reach = capacity * sampleRate;
+        for (; d < histogram.size() && d < reach; d++) hits += histogram[d];
+        double ratio = trackedRefs ? (double)(trackedRefs - hits) / trackedRefs : 0.0;
+        std::fprintf(out, "%s,%llu,%llu,%.6f,%llu\n", curve, (unsigned long long)capacity,
+                     (unsigned long long)(capacity * itemBytes), ratio,
+                     (unsigned long long)std::llround(ratio * totalRefs));
+    }
+}
+
+// The curve at power-of-two capacities, ending where it goes flat
+void StackDistance::showStats(const std::string& title, uint64_t itemBytes) const {
+    std::cout << "[" << title << "] " << totalRefs << " references, " << distinctKeys() << " distinct";
+    if (sampleRate < 1.0) std::cout << " (sampled at " << std::fixed << std::setprecision(2) << sampleRate * 100 << "%)";
+    std::cout << std::endl;
+
+    uint64_t last = flatCapacity();
+    for (uint64_t capacity = 1;; capacity *= 2) {
+        if (capacity > last) capacity = last;
+        std::cout << "  " << std::right << std::setw(10) << capacity << " x " << itemBytes << " bytes"
+                  << " -> Miss ratio: " << std::fixed << std::setprecision(2) << missRatio(capacity) * 100
+                  << "%" << std::endl;
+        if (capacity == last) break;
+    }
+}
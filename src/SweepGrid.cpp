@@ -0,0 +1,94 @@
+#include "../include/SweepGrid.h"
+#include <fstream>
+#include <sstream>
+
+// Collapses runs of spaces and trims the ends
+static std::string tidy(const std::string& text) {
+    std::stringstream ss(text);
+    std::string word, result;
+    while (ss >> word) result += (result.empty() ? "" : " ") + word;
+    return result;
+}
+
+bool SweepGrid::load(const std::string& path, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    lines.clear();
+    axes.clear();
+    std::string text;
+    int lineNumber = 0;
+    while (std::getline(in, text)) {
+        lineNumber++;
+        size_t comment = text.find('#');
+        if (comment != std::string::npos) text.erase(comment);
+        if (tidy(text).empty()) continue;
+
+        Line line;
+        std::string name;       // The line so far, earlier groups as '*'
+        size_t pos = 0;
+        for (;;) {
+            size_t open = text.find('{', pos);
+            size_t close = (open == std::string::npos) ? open : text.find('}', open);
+            if (open != std::string::npos && close == std::string::npos) {
+                error = "unclosed '{' on line " + std::to_string(lineNumber);
+                return false;
+            }
+            line.text.push_back(text.substr(pos, open - pos));
+            if (open == std::string::npos) break;
+            name += text.substr(pos, open - pos);
+
+            Axis axis;
+            axis.name = tidy(name);
+            std::stringstream group(text.substr(open + 1, close - open - 1));
+            std::string choice;
+            while (std::getline(group, choice, '|')) {
+                if (tidy(choice).empty()) {
+                    error = "empty choice on line " + std::to_string(lineNumber);
+                    return false;
+                }
+                axis.choices.push_back(tidy(choice));
+            }
+            if (axis.choices.empty()) {
+                error = "empty group on line " + std::to_string(lineNumber);
+                return false;
+            }
+            line.axes.push_back(axes.size());
+            axes.push_back(axis);
+            name += " * ";
+            pos = close + 1;
+        }
+        lines.push_back(line);
+    }
+
+    if (lines.empty()) {
+        error = path + " holds no commands";
+        return false;
+    }
+    return true;
+}
+
+size_t SweepGrid::pointCount() const {
+    size_t count = 1;
+    for (const auto& axis : axes) count *= axis.choices.size();
+    return count;
+}
+
+void SweepGrid::point(size_t index, std::vector<std::string>& commands, std::vector<std::string>& labels) const {
+    labels.assign(axes.size(), std::string());
+    for (size_t a = axes.size(); a-- > 0;) {
+        size_t count = axes[a].choices.size();
+        labels[a] = axes[a].choices[index % count];
+        index /= count;
+    }
+
+    commands.clear();
+    for (const auto& line : lines) {
+        std::string command = line.text[0];
+        for (size_t g = 0; g < line.axes.size(); g++) command += labels[line.axes[g]] + line.text[g + 1];
+        commands.push_back(command);
+    }
+}
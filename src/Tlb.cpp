@@ -0,0 +1,146 @@
+#include "../include/Tlb.h"
+#include "../include/CacheEngine.h"
+#include <iostream>
+#include <iomanip>
+
+// Per-set storage follows the cache engine: a padded page-number row for
+// matchTags(), a parallel ASID row and one valid mask per set.
+template <typename Policy>
+class TlbEngine : public TlbLevel {
+private:
+    int stride;
+    uint64_t allWays;
+    std::vector<uint64_t> pages;
+    std::vector<uint16_t> asids;
+    std::vector<uint64_t> frames;
+    std::vector<uint64_t> validMask;
+    Policy replacement;
+
+    // Each size order has its own tag space: the page number at that size
+    // with the order in the low bits
+    uint64_t keyOf(uint64_t page, int order) const { return ((page >> orderShift[order]) << 2) | (uint64_t)order; }
+    size_t setOf(uint64_t page, int order) const { return (size_t)((page >> orderShift[order]) % numSets); }
+
+    // Valid ways holding this key for this ASID
+    uint64_t match(size_t set, uint16_t asid, uint64_t key) const {
+        uint64_t ways = matchTags(&pages[set * stride], stride, key) & validMask[set];
+        uint64_t result = 0;
+        while (ways) {
+            int w = findFirstSet(ways);
+            ways &= ways - 1;
+            if (asids[set * stride + w] == asid) result |= (uint64_t)1 << w;
+        }
+        return result;
+    }
+
+public:
+    TlbEngine(const std::string& name, const TlbConfig& config, unsigned seed)
+        : TlbLevel(name, config),
+          stride((config.associativity + TAG_LANES - 1) / TAG_LANES * TAG_LANES),
+          allWays(config.associativity >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << config.associativity) - 1)),
+          pages(numSets * stride, 0), asids(numSets * stride, 0), frames(numSets * stride, 0),
+          validMask(numSets, 0), replacement(numSets, config.associativity, seed) {}
+
+    bool lookup(uint16_t asid, uint64_t page, uint64_t& frame, int& order) override {
+        for (int o = 0; o <= MAX_ORDER; o++) {
+            if (o > 0 && !orderUsed[o]) continue;
+            size_t set = setOf(page, o);
+            uint64_t hit = match(set, asid, keyOf(page, o));
+            if (!hit) continue;
+
+            int way = findFirstSet(hit);
+            hits++;
+            replacement.onHit(set, way);
+            frame = frames[set * stride + way] + (page & ((1ull << orderShift[o]) - 1));
+            order = o;
+            return true;
+        }
+        misses++;
+        return false;
+    }
+
+    void insert(uint16_t asid, uint64_t page, uint64_t frame, int order) override {
+        uint64_t offset = page & ((1ull << orderShift[order]) - 1);
+        size_t set = setOf(page, order);
+        uint64_t empty = ~validMask[set] & allWays;
+        int way = empty ? findFirstSet(empty) : replacement.victim(set);
+        pages[set * stride + way] = keyOf(page, order);
+        asids[set * stride + way] = asid;
+        frames[set * stride + way] = frame - offset;
+        validMask[set] |= (uint64_t)1 << way;
+        replacement.onFill(set, way);
+        orderUsed[order] = true;
+    }
+
+    void invalidate(uint16_t asid, uint64_t page) override {
+        for (int o = 0; o <= MAX_ORDER; o++) {
+            if (o > 0 && !orderUsed[o]) continue;
+            size_t set = setOf(page, o);
+            validMask[set] &= ~match(set, asid, keyOf(page, o));
+        }
+    }
+
+    void flush() override {
+        flushes++;
+        for (auto& mask : validMask) mask = 0;
+    }
+
+    void flushAsid(uint16_t asid) override {
+        flushes++;
+        for (size_t set = 0; set < numSets; set++) {
+            for (int w = 0; w < associativity; w++) {
+                if (asids[set * stride + w] == asid) validMask[set] &= ~((uint64_t)1 << w);
+            }
+        }
+    }
+};
+
+TlbLevel::TlbLevel(const std::string& name, const TlbConfig& config)
+    : levelName(name), entries(config.entries), associativity(config.associativity),
+      policy(config.policy), latency(config.latency),
+      numSets(config.entries / config.associativity), hits(0), misses(0), flushes(0) {
+    for (int o = 0; o <= MAX_ORDER; o++) {
+        orderShift[o] = 0;
+        orderUsed[o] = false;
+    }
+}
+
+const int TlbLevel::MAX_ORDER;
+
+void TlbLevel::setPageShifts(int hugeShift, int giantShift) {
+    orderShift[1] = hugeShift;
+    orderShift[2] = giantShift;
+}
+
+const char* TlbLevel::configError(const TlbConfig& config) {
+    if (config.associativity <= 0 || config.associativity > CacheLevel::MAX_WAYS) return "associativity must be 1..64";
+    if (config.entries < config.associativity) return "fewer entries than ways";
+    if (config.entries % config.associativity) return "entries must be a multiple of the associativity";
+    if (config.policy == POLICY_PLRU && !isPowerOfTwo(config.associativity))
+        return "Tree-PLRU needs a power-of-two associativity";
+    if (config.latency < 0) return "latency cannot be negative";
+    return nullptr;
+}
+
+TlbLevel* TlbLevel::create(const std::string& name, const TlbConfig& config, unsigned seed) {
+    if (configError(config)) return nullptr;
+    switch (config.policy) {
+        case POLICY_LRU: return new TlbEngine<LruPolicy>(name, config, seed);
+        case POLICY_FIFO: return new TlbEngine<FifoPolicy>(name, config, seed);
+        case POLICY_PLRU: return new TlbEngine<PlruPolicy>(name, config, seed);
+        case POLICY_SRRIP: return new TlbEngine<RripPolicy<false> >(name, config, seed);
+        case POLICY_BRRIP: return new TlbEngine<RripPolicy<true> >(name, config, seed);
+        case POLICY_NRU: return new TlbEngine<NruPolicy>(name, config, seed);
+        case POLICY_RANDOM: return new TlbEngine<RandomPolicy>(name, config, seed);
+    }
+    return nullptr;
+}
+
+void TlbLevel::showStats() const {
+    uint64_t total = hits + misses;
+    double hitRate = (total > 0) ? (double)hits / total * 100.0 : 0.0;
+    std::cout << "[" << levelName << "] " << entries << " entries, " << associativity << "-way, "
+              << CacheLevel::policyName(policy) << ", " << latency << " cycles | Hits: " << hits
+              << " Misses: " << misses << " HitRate: " << std::fixed << std::setprecision(2)
+              << hitRate << "% Flushes: " << flushes << std::endl;
+}
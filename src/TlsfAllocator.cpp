@@ -0,0 +1,246 @@
+#include "../include/TlsfAllocator.h"
+#include "../include/BitOps.h"
+#include "../include/EventLog.h"
+#include <iostream>
+
+const int TlsfAllocator::ALIGN_LOG2;
+const size_t TlsfAllocator::ALIGN_SIZE;
+const int TlsfAllocator::SL_INDEX_LOG2;
+const int TlsfAllocator::SL_INDEX_COUNT;
+const int TlsfAllocator::FL_INDEX_SHIFT;
+const size_t TlsfAllocator::SMALL_BLOCK_SIZE;
+const size_t TlsfAllocator::MIN_BLOCK_SIZE;
+const int TlsfAllocator::NONE;
+
+TlsfAllocator::TlsfAllocator(size_t size)
+    : MemoryManager(size), firstBlock(NONE), flBitmap(0),
+      usedMemory(0), usedBlocks(0), freeBlockCount(0), internalFrag(0) {
+    this->allocatorType = "tlsf";
+
+    int fl, sl;
+    mappingInsert(size > 0 ? size : 1, fl, sl);
+    flIndexCount = fl + 1;
+    slBitmap.assign(flIndexCount, 0);
+    freeHeads.assign(flIndexCount * SL_INDEX_COUNT, NONE);
+
+    if (size > 0) {
+        firstBlock = newBlock(0, size);
+        insertFree(firstBlock);
+    }
+    MEMSIM_LOG(std::cout << "[TLSF] Initialized. Size: " << totalMemorySize << " bytes, "
+              << flIndexCount << "x" << SL_INDEX_COUNT << " size classes" << std::endl);
+}
+
+// ---------------- Size class mapping ----------------
+
+// Bin that a block of exactly this size belongs to
+void TlsfAllocator::mappingInsert(size_t size, int& fl, int& sl) const {
+    if (size < SMALL_BLOCK_SIZE) {
+        fl = 0;
+        sl = (int)(size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT));
+    } else {
+        int f = findLastSet(size);
+        sl = (int)(size >> (f - SL_INDEX_LOG2)) ^ SL_INDEX_COUNT;
+        fl = f - (FL_INDEX_SHIFT - 1);
+    }
+}
+
+// First bin whose every block is large enough (request rounded up to the
+// next second-level boundary), so the head of any non-empty bin from here
+// on satisfies the request without searching the list.
+void TlsfAllocator::mappingSearch(size_t size, int& fl, int& sl) const {
+    if (size >= SMALL_BLOCK_SIZE) {
+        size += ((size_t)1 << (findLastSet(size) - SL_INDEX_LOG2)) - 1;
+    }
+    mappingInsert(size, fl, sl);
+}
+
+int TlsfAllocator::findSuitableBlock(int& fl, int& sl) const {
+    uint32_t slMap = slBitmap[fl] & (~0u << sl);
+    if (!slMap) {
+        uint64_t flMap = (fl + 1 < 64) ? (flBitmap & (~(uint64_t)0 << (fl + 1))) : 0;
+        if (!flMap) return NONE;
+        fl = findFirstSet(flMap);
+        slMap = slBitmap[fl];
+    }
+    sl = findFirstSet(slMap);
+    return freeHeads[fl * SL_INDEX_COUNT + sl];
+}
+
+// ---------------- Block pool and bins ----------------
+
+int TlsfAllocator::newBlock(size_t start, size_t size) {
+    int b;
+    if (!spareSlots.empty()) {
+        b = spareSlots.back();
+        spareSlots.pop_back();
+    } else {
+        b = (int)blocks.size();
+        blocks.push_back(Block());
+    }
+    Block& block = blocks[b];
+    block.start = start;
+    block.size = size;
+    block.requested = 0;
+    block.id = 0;
+    block.isFree = true;
+    block.prevPhys = block.nextPhys = NONE;
+    block.prevFree = block.nextFree = NONE;
+    return b;
+}
+
+void TlsfAllocator::insertFree(int b) {
+    int fl, sl;
+    mappingInsert(blocks[b].size, fl, sl);
+    int& head = freeHeads[fl * SL_INDEX_COUNT + sl];
+
+    blocks[b].isFree = true;
+    blocks[b].prevFree = NONE;
+    blocks[b].nextFree = head;
+    if (head != NONE) blocks[head].prevFree = b;
+    head = b;
+
+    flBitmap |= (uint64_t)1 << fl;
+    slBitmap[fl] |= 1u << sl;
+    freeBlockCount++;
+}
+
+void TlsfAllocator::removeFree(int b) {
+    int fl, sl;
+    mappingInsert(blocks[b].size, fl, sl);
+    int& head = freeHeads[fl * SL_INDEX_COUNT + sl];
+
+    Block& block = blocks[b];
+    if (block.prevFree != NONE) blocks[block.prevFree].nextFree = block.nextFree;
+    else head = block.nextFree;
+    if (block.nextFree != NONE) blocks[block.nextFree].prevFree = block.prevFree;
+
+    if (head == NONE) {
+        slBitmap[fl] &= ~(1u << sl);
+        if (!slBitmap[fl]) flBitmap &= ~((uint64_t)1 << fl);
+    }
+    block.isFree = false;
+    freeBlockCount--;
+}
+
+int TlsfAllocator::mergeInto(int left, int right) {
+    blocks[left].size += blocks[right].size;
+    blocks[left].nextPhys = blocks[right].nextPhys;
+    if (blocks[left].nextPhys != NONE) blocks[blocks[left].nextPhys].prevPhys = left;
+    spareSlots.push_back(right);
+    return left;
+}
+
+// ---------------- Allocator interface ----------------
+
+bool TlsfAllocator::allocate(size_t size) {
+    numAllocRequests++;
+
+    int b = NONE;
+    size_t adjusted = MIN_BLOCK_SIZE;
+    if (size <= totalMemorySize) {
+        if (size > adjusted) adjusted = (size + ALIGN_SIZE - 1) & ~(ALIGN_SIZE - 1);
+        int fl, sl;
+        mappingSearch(adjusted, fl, sl);
+        if (fl < flIndexCount) b = findSuitableBlock(fl, sl);
+    }
+
+    if (b == NONE) {
+        MEMSIM_LOG(std::cout << "[TLSF] Allocation Failed: no free block for " << size << " bytes" << std::endl);
+        MEMSIM_EVENT(EV_ALLOC_FAIL, EVSRC_HEAP, 0, 0, size);
+        numFailedAllocs++;
+        return false;
+    }
+
+    removeFree(b);
+
+    // Return the tail to the bins if it can stand as a block of its own
+    if (blocks[b].size - adjusted >= MIN_BLOCK_SIZE) {
+        int rest = newBlock(blocks[b].start + adjusted, blocks[b].size - adjusted);
+        blocks[rest].prevPhys = b;
+        blocks[rest].nextPhys = blocks[b].nextPhys;
+        if (blocks[rest].nextPhys != NONE) blocks[blocks[rest].nextPhys].prevPhys = rest;
+        blocks[b].nextPhys = rest;
+        blocks[b].size = adjusted;
+        insertFree(rest);
+    }
+
+    Block& block = blocks[b];
+    block.id = nextBlockId++;
+    block.requested = size;
+    idToBlock[block.id] = b;
+
+    usedMemory += block.size;
+    usedBlocks++;
+    internalFrag += block.size - size;
+
+    MEMSIM_LOG(std::cout << "Allocated block id=" << block.id
+              << " at address=0x" << std::hex << block.start << std::dec
+              << " (" << block.size << " bytes)" << std::endl);
+    MEMSIM_EVENT(EV_ALLOC, EVSRC_HEAP, block.id, block.start, block.size);
+
+    numSuccessfulAllocs++;
+    return true;
+}
+
+bool TlsfAllocator::deallocate(int blockId) {
+    auto found = idToBlock.find(blockId);
+    if (found == idToBlock.end()) {
+        MEMSIM_LOG(std::cout << "Error: Block ID " << blockId << " not found." << std::endl);
+        return false;
+    }
+
+    int b = found->second;
+    idToBlock.erase(found);
+
+    usedMemory -= blocks[b].size;
+    usedBlocks--;
+    internalFrag -= blocks[b].size - blocks[b].requested;
+    blocks[b].id = 0;
+    blocks[b].requested = 0;
+
+    MEMSIM_LOG(std::cout << "Block " << blockId << " freed." << std::endl);
+    MEMSIM_EVENT(EV_FREE, EVSRC_HEAP, blockId, blocks[b].start, blocks[b].size);
+    numFrees++;
+
+    // Immediate coalescing with both physical neighbours
+    int prev = blocks[b].prevPhys;
+    if (prev != NONE && blocks[prev].isFree) {
+        removeFree(prev);
+        b = mergeInto(prev, b);
+    }
+    int next = blocks[b].nextPhys;
+    if (next != NONE && blocks[next].isFree) {
+        removeFree(next);
+        b = mergeInto(b, next);
+    }
+    insertFree(b);
+    return true;
+}
+
+void TlsfAllocator::dumpMemory() {
+    std::cout << "\n--- Memory Dump (TLSF) ---" << std::endl;
+    for (int b = firstBlock; b != NONE; b = blocks[b].nextPhys) {
+        const Block& block = blocks[b];
+        std::cout << "[0x" << std::hex << block.start << "-0x"
+                  << (block.start + block.size - 1) << std::dec << "] ";
+        if (block.isFree) std::cout << "FREE (" << block.size << " bytes)" << std::endl;
+        else std::cout << "USED (ID=" << block.id << ", " << block.size << " bytes)" << std::endl;
+    }
+    std::cout << "--------------------------\n" << std::endl;
+}
+
+void TlsfAllocator::showStats() {
+    // The largest free block sits in the highest non-empty bin
+    size_t largestFreeBlock = 0;
+    if (flBitmap) {
+        int fl = findLastSet(flBitmap);
+        int sl = findLastSet(slBitmap[fl]);
+        for (int b = freeHeads[fl * SL_INDEX_COUNT + sl]; b != NONE; b = blocks[b].nextFree) {
+            if (blocks[b].size > largestFreeBlock) largestFreeBlock = blocks[b].size;
+        }
+    }
+
+    printSummary(usedMemory, totalMemorySize - usedMemory, usedBlocks, freeBlockCount,
+                 internalFrag, largestFreeBlock);
+}
@@ -0,0 +1,267 @@
+#include "../include/TraceReader.h"
+#include <climits>
+#include <cstring>
+
+static const size_t TRACE_BUFFER_SIZE = 1 << 20; // 1 MiB read chunks
+
+// ---------------- Small parsing helpers ----------------
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) p++;
+    return p;
+}
+
+static inline int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Parses an unsigned number in the given base. Base 0 follows the strtoul /
+// std::stoi(…, 0) rules the REPL uses: "0x" prefix = hex, leading 0 = octal.
+// Fails on overflow, or unless the number ends the line or is followed by
+// whitespace or one of the characters in stops.
+static bool parseNumber(const char*& p, const char* end, int base, unsigned long long& out,
+                        const char* stops = "") {
+    p = skipSpaces(p, end);
+    if (p >= end) return false;
+
+    if ((base == 0 || base == 16) && end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        p += 2;
+        base = 16;
+    } else if (base == 0) {
+        base = (p[0] == '0' && end - p > 1 && hexDigit(p[1]) >= 0 && hexDigit(p[1]) < 8) ? 8 : 10;
+    }
+
+    unsigned long long value = 0;
+    const char* start = p;
+    while (p < end) {
+        int d = hexDigit(*p);
+        if (d < 0 || d >= base) break;
+        if (value > (ULLONG_MAX - d) / base) return false;
+        value = value * base + d;
+        p++;
+    }
+    if (p == start) return false;
+    if (p < end && !isSpace(*p) && (*p == '\0' || !std::strchr(stops, *p))) return false;
+    out = value;
+    return true;
+}
+
+static bool matchWord(const char*& p, const char* end, const char* word) {
+    size_t n = std::strlen(word);
+    if ((size_t)(end - p) < n || std::memcmp(p, word, n) != 0) return false;
+    if (p + n < end && !isSpace(p[n])) return false;
+    p += n;
+    return true;
+}
+
+// ---------------- TraceReader ----------------
+
+TraceReader::TraceReader(const std::string& path, TraceFormat fmt)
+    : file(nullptr), buffer(TRACE_BUFFER_SIZE), pos(0), len(0), eof(false),
+      format(fmt), lineNumber(0), skippedLines(0), hasPending(false) {
+    file = std::fopen(path.c_str(), "rb");
+}
+
+TraceReader::~TraceReader() {
+    if (file) std::fclose(file);
+}
+
+bool TraceReader::parseFormat(const std::string& name, TraceFormat& fmt) {
+    if (name == "auto") fmt = TRACE_AUTO;
+    else if (name == "native" || name == "memsim") fmt = TRACE_NATIVE;
+    else if (name == "din" || name == "dinero") fmt = TRACE_DINERO;
+    else if (name == "lackey" || name == "valgrind") fmt = TRACE_LACKEY;
+    else return false;
+    return true;
+}
+
+// Returns the next line (without the newline). Refills the buffer when the
+// line crosses a chunk boundary, growing it only for pathologically long lines.
+bool TraceReader::nextLine(const char*& begin, const char*& end) {
+    while (true) {
+        const char* data = buffer.data();
+        const char* nl = (const char*)std::memchr(data + pos, '\n', len - pos);
+        if (nl) {
+            begin = data + pos;
+            end = nl;
+            pos = (nl - data) + 1;
+            lineNumber++;
+            return true;
+        }
+
+        if (eof) {
+            if (pos < len) {
+                begin = data + pos;
+                end = data + len;
+                pos = len;
+                lineNumber++;
+                return true;
+            }
+            return false;
+        }
+
+        // Shift the partial line to the front and read more
+        size_t remaining = len - pos;
+        if (remaining > 0 && pos > 0) std::memmove(buffer.data(), buffer.data() + pos, remaining);
+        pos = 0;
+        len = remaining;
+        if (len == buffer.size()) buffer.resize(buffer.size() * 2);
+
+        size_t got = std::fread(buffer.data() + len, 1, buffer.size() - len, file);
+        len += got;
+        if (got == 0) eof = true;
+    }
+}
+
+TraceFormat TraceReader::detect(const char* begin, const char* end) const {
+    const char* p = skipSpaces(begin, end);
+    if (end - p >= 2 && p[0] == '=' && p[1] == '=') return TRACE_LACKEY;
+
+    // Lackey: "I  0400d7d4,8" / " L 04222cac,8"
+    if (p < end && (*p == 'I' || *p == 'L' || *p == 'S' || *p == 'M') &&
+        p + 1 < end && isSpace(p[1]) && std::memchr(p, ',', end - p)) {
+        return TRACE_LACKEY;
+    }
+
+    // DineroIV: numeric label followed by an address
+    if (p < end && *p >= '0' && *p <= '9') return TRACE_DINERO;
+
+    return TRACE_NATIVE;
+}
+
+bool TraceReader::next(TraceRecord& rec) {
+    if (hasPending) {
+        rec = pending;
+        hasPending = false;
+        return true;
+    }
+
+    const char* begin;
+    const char* end;
+    while (nextLine(begin, end)) {
+        const char* p = skipSpaces(begin, end);
+        if (p == end || *p == '#') continue;
+
+        if (format == TRACE_AUTO) format = detect(begin, end);
+        rec.core = -1;
+
+        ParseResult result;
+        switch (format) {
+            case TRACE_DINERO: result = parseDinero(p, end, rec); break;
+            case TRACE_LACKEY: result = parseLackey(p, end, rec); break;
+            default:           result = parseNative(p, end, rec); break;
+        }
+        if (result == PARSE_RECORD) return true;
+        if (result == PARSE_ERROR) skippedLines++;
+    }
+    return false;
+}
+
+// An address, optionally followed by "@<core>"
+static bool parseReference(const char* p, const char* end, TraceRecord& rec) {
+    if (!parseNumber(p, end, 0, rec.value, "@")) return false;
+    p = skipSpaces(p, end);
+    if (p == end || *p != '@') return true;
+    unsigned long long core;
+    if (!parseNumber(++p, end, 10, core) || core > 0xFFFF) return false;
+    rec.core = (int)core;
+    return true;
+}
+
+TraceReader::ParseResult TraceReader::parseNative(const char* p, const char* end, TraceRecord& rec) {
+    const char* q = p;
+    if (matchWord(q, end, "read") || matchWord(q, end, "access")) {
+        rec.op = TRACE_READ;
+        return parseReference(q, end, rec) ? PARSE_RECORD : PARSE_ERROR;
+    }
+    if (matchWord(q, end, "write")) {
+        rec.op = TRACE_WRITE;
+        return parseReference(q, end, rec) ? PARSE_RECORD : PARSE_ERROR;
+    }
+    if (matchWord(q, end, "malloc")) {
+        rec.op = TRACE_MALLOC;
+        return parseNumber(q, end, 10, rec.value) ? PARSE_RECORD : PARSE_ERROR;
+    }
+    if (matchWord(q, end, "free")) {
+        rec.op = TRACE_FREE;
+        return parseNumber(q, end, 10, rec.value) ? PARSE_RECORD : PARSE_ERROR;
+    }
+
+    if (matchWord(q, end, "as")) {
+        rec.op = TRACE_SWITCH;
+        return parseNumber(q, end, 10, rec.value) && rec.value <= 0xFFFF ? PARSE_RECORD : PARSE_ERROR;
+    }
+
+    // Setup lines (init, set, config, ...) go back through the REPL
+    rec.op = TRACE_COMMAND;
+    rec.value = 0;
+    rec.command.assign(p, end);
+    return PARSE_RECORD;
+}
+
+TraceReader::ParseResult TraceReader::parseDinero(const char* p, const char* end, TraceRecord& rec) {
+    unsigned long long label;
+    if (!parseNumber(p, end, 10, label)) return PARSE_ERROR;
+
+    // 0 = data read, 1 = data write, 2 = instruction fetch (unified caches
+    // treat it as a read). 3 (escape) and 4 (flush) carry no reference.
+    if (label == 0 || label == 2) rec.op = TRACE_READ;
+    else if (label == 1) rec.op = TRACE_WRITE;
+    else if (label == 3 || label == 4) return PARSE_IGNORE;
+    else return PARSE_ERROR;
+
+    return parseNumber(p, end, 16, rec.value) ? PARSE_RECORD : PARSE_ERROR;
+}
+
+TraceReader::ParseResult TraceReader::parseLackey(const char* p, const char* end, TraceRecord& rec) {
+    if (end - p >= 2 && p[0] == '=' && p[1] == '=') return PARSE_IGNORE; // valgrind banner
+
+    char kind = *p++;
+    if (!parseNumber(p, end, 16, rec.value, ",")) return PARSE_ERROR;
+
+    switch (kind) {
+        case 'I':
+        case 'L':
+            rec.op = TRACE_READ;
+            return PARSE_RECORD;
+        case 'S':
+            rec.op = TRACE_WRITE;
+            return PARSE_RECORD;
+        case 'M':
+            rec.op = TRACE_READ;
+            pending.op = TRACE_WRITE;
+            pending.value = rec.value;
+            hasPending = true;
+            return PARSE_RECORD;
+        default:
+            return PARSE_ERROR;
+    }
+}
+
+// ---------------- DecodedTrace ----------------
+
+bool DecodedTrace::load(const std::string& path, TraceFormat fmt) {
+    TraceReader reader(path, fmt);
+    if (!reader.isOpen()) return false;
+
+    records.clear();
+    commands.clear();
+    TraceRecord rec;
+    while (reader.next(rec)) {
+        DecodedRecord packed = { rec.value, rec.core, rec.op };
+        if (rec.op == TRACE_COMMAND) {
+            packed.value = commands.size();
+            commands.push_back(rec.command);
+        }
+        records.push_back(packed);
+    }
+    skippedLines = reader.getSkippedLines();
+    return true;
+}
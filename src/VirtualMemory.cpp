@@ -1,109 +1,945 @@
 #include "VirtualMemory.h"
+#include "EventLog.h"
 #include <iostream>
-#include <climits>
+#include <cmath>
+#include <iterator>
 
 using namespace std;
 
-VirtualMemory::VirtualMemory(int va_bits,
-                             int ps,
-                             int phys_mem,
-                             const string& policy)
-    : virtual_address_bits(va_bits),
-      page_size(ps),
-      physical_memory_size(phys_mem),
-      replacement_policy(policy),
-      timer(0),
+const uint64_t VirtualMemory::NO_PAGE;
+const int VirtualMemory::MAX_ORDER;
+const int VirtualMemory::THRASH_WINDOW;
+const int VirtualMemory::THRASH_PERCENT;
+const int VirtualMemory::PROCESS_TABLE_SHIFT;
+
+static const char* const ALLOTMENT_NAMES[] = { "fixed", "PFF", "working-set" };
+
+static int log2_exact(uint64_t n) {
+    int bits = 0;
+    while (n > 1) { n >>= 1; bits++; }
+    return bits;
+}
+
+const char* VirtualMemory::config_error(const VmConfig& config) {
+    if (config.page_size < PageTable::PTE_BYTES || (config.page_size & (config.page_size - 1)))
+        return "page size must be a power of two of at least 8 bytes";
+    if (config.phys_mem_size < (uint64_t)config.page_size)
+        return "RAM must hold at least one page";
+    if (config.va_bits < 1 || config.va_bits > 64)
+        return "virtual address bits must be 1-64";
+    PagePolicy policy;
+    if (!PageReplacer::parse_policy(config.policy, policy))
+        return "unknown page replacement policy";
+    if (config.walk_latency < 0 || config.disk_read_latency < 0 || config.disk_write_latency < 0)
+        return "latencies cannot be negative";
+    if (config.clean_first_window < 0)
+        return "clean-first window cannot be negative";
+    for (const auto& region : config.huge_regions) {
+        int max_order = config.pt_levels - 1 < MAX_ORDER ? config.pt_levels - 1 : MAX_ORDER;
+        if (region.order < 1 || region.order > max_order)
+            return "giant pages need a page table of at least 3 levels";
+        if (region.length == 0)
+            return "huge-page region is empty";
+    }
+    if (config.pff_low < 0 || config.pff_low > config.pff_high)
+        return "PFF thresholds must satisfy 0 <= low <= high";
+    if (config.ws_window < 1)
+        return "working-set window must be at least one reference";
+    if (config.readahead != READAHEAD_OFF && (config.readahead_pages < 1 || config.readahead_pages > 4096))
+        return "readahead window must be 1-4096 pages";
+    if (config.readahead_page_latency < 0 || config.zswap_latency < 0)
+        return "latencies cannot be negative";
+    if (config.zswap_bytes > 0 && config.zswap_bytes + (uint64_t)config.page_size > config.phys_mem_size)
+        return "compressed pool leaves no frames";
+    if (config.zswap_ratio < 1.0)
+        return "compression ratio must be at least 1";
+    if (config.dtlb.entries > 0 && TlbLevel::configError(config.dtlb))
+        return TlbLevel::configError(config.dtlb);
+    if (config.stlb.entries > 0 && TlbLevel::configError(config.stlb))
+        return TlbLevel::configError(config.stlb);
+    return PageTable::geometry_error(config.va_bits - log2_exact(config.page_size), config.pt_levels);
+}
+
+const char* VirtualMemory::allotment_name(FrameAllotment allotment) {
+    return ALLOTMENT_NAMES[allotment];
+}
+
+VirtualMemory::VirtualMemory(const VmConfig& config)
+    : virtual_address_bits(config.va_bits),
+      page_size(config.page_size),
+      offset_bits(log2_exact(config.page_size)),
+      physical_memory_size(config.phys_mem_size),
+      fresh_frame(0),
+      dtlb(config.dtlb.entries > 0 ? TlbLevel::create("DTLB", config.dtlb) : nullptr),
+      stlb(config.stlb.entries > 0 ? TlbLevel::create("STLB", config.stlb) : nullptr),
+      walks_to_cache(config.walks_to_cache),
+      walk_latency(config.walk_latency),
+      last_cycles(0),
+      disk_read_latency(config.disk_read_latency),
+      disk_write_latency(config.disk_write_latency),
+      last_disk(0),
+      replacement_policy(config.policy),
+      replacer(nullptr),
       page_hits(0),
       page_faults(0),
-      disk_accesses(0) {
+      disk_reads(0),
+      disk_read_cycles(0),
+      disk_writes(0),
+      clean_evictions(0),
+      dirty_evictions(0),
+      address_errors(0),
+      translation_cycles(0),
+      reservations_broken(0),
+      page_number_bits(config.va_bits - log2_exact(config.page_size)),
+      pt_levels(config.pt_levels),
+      // Page tables live just above RAM
+      table_base((config.phys_mem_size + config.page_size - 1) / config.page_size * config.page_size),
+      page_policy(PAGE_FIFO),
+      clean_first_window(config.clean_first_window),
+      local_replacement(config.local_replacement),
+      allotment(config.allotment),
+      pff_low(config.pff_low),
+      pff_high(config.pff_high),
+      ws_window(config.ws_window),
+      current(nullptr),
+      context_switches(0),
+      window_refs(0),
+      window_faults(0),
+      windows(0),
+      thrash_windows(0),
+      readahead_mode(config.readahead),
+      readahead_pages((uint64_t)config.readahead_pages),
+      readahead_page_latency(config.readahead_page_latency),
+      ra_next(0),
+      ra_count(0),
+      ra_async(false),
+      ra_batches(0),
+      ra_async_batches(0),
+      ra_pages(0),
+      ra_used(0),
+      ra_wasted(0),
+      ra_overlapped_cycles(0),
+      zswap_capacity(config.zswap_bytes),
+      zswap_ratio(config.zswap_ratio),
+      zswap_sample(config.zswap_sample),
+      zswap_latency(config.zswap_latency),
+      zswap_writeback(config.zswap_writeback),
+      memory(nullptr),
+      pool_bytes(0),
+      zswap_stores(0),
+      zswap_same_filled(0),
+      zswap_hits(0),
+      zswap_writebacks(0),
+      zswap_rejects(0) {
+
+    // The compressed pool takes the top of RAM
+    num_frames = (physical_memory_size - zswap_capacity) / page_size;
+
+    // A window of more than half of RAM would evict the stream it reads
+    if (readahead_mode != READAHEAD_OFF && readahead_pages > num_frames / 2) readahead_pages = num_frames / 2;
+
+    // Replacement is global unless each process gets its own replacer
+    PageReplacer::parse_policy(config.policy, page_policy);
+    if (!local_replacement) {
+        replacer = PageReplacer::create(page_policy, num_frames);
+        replacer->prefer_clean(&frame_dirty, clean_first_window);
+    }
+    switch_process(0);
+
+    max_order = current->page_table.max_order();
+    for (int o = 0; o <= MAX_ORDER; o++) {
+        order_bits[o] = (o == 0) ? 0 : current->page_table.order_shift(o <= max_order ? o : max_order);
+        hits_by_order[o] = faults_by_order[o] = promotions[o] = demotions[o] = 0;
+    }
+    if (dtlb) dtlb->setPageShifts(order_bits[1], order_bits[2]);
+    if (stlb) stlb->setPageShifts(order_bits[1], order_bits[2]);
+
+    // Block bookkeeping is only kept when some region can use it
+    reserve_blocks = false;
+    for (const auto& region : config.huge_regions) {
+        huge_regions.push_back({region.start >> offset_bits, (region.start + region.length) >> offset_bits,
+                                region.order, region.promote});
+        if (region.promote) reserve_blocks = true;
+    }
+    if (!huge_regions.empty()) {
+        for (int o = 1; o <= max_order; o++) {
+            uint64_t blocks = num_frames >> order_bits[o];
+            block_free[o].assign(blocks, order_pages(o));
+            for (uint64_t b = blocks; b-- > 0;) free_blocks[o].push_back(b);
+        }
+    }
+}
+
+VirtualMemory::~VirtualMemory() {
+    delete dtlb;
+    delete stlb;
+    delete replacer;
+    for (auto& entry : processes) {
+        delete entry.second->replacer;
+        delete entry.second;
+    }
+}
+
+void VirtualMemory::flush_tlb() {
+    if (dtlb) dtlb->flush();
+    if (stlb) stlb->flush();
+}
+
+void VirtualMemory::flush_tlb(uint16_t asid) {
+    if (dtlb) dtlb->flushAsid(asid);
+    if (stlb) stlb->flushAsid(asid);
+}
+
+const VirtualMemory::PageRegion* VirtualMemory::region_of(uint64_t page) const {
+    for (const auto& region : huge_regions) {
+        if (page >= region.first && page < region.end) return &region;
+    }
+    return nullptr;
+}
+
+void VirtualMemory::grow_frames(uint64_t end) {
+    if (end <= frame_state.size()) return;
+    frame_owner.resize(end, NO_PAGE);
+    frame_pid.resize(end, 0);
+    frame_dirty.resize(end, 0);
+    frame_state.resize(end, FRAME_FREE);
+    frame_order.resize(end, 0);
+    if (readahead_mode != READAHEAD_OFF) frame_prefetched.resize(end, 0);
+    if (reserve_blocks) frame_reservation.resize(end, NO_PAGE);
+}
+
+void VirtualMemory::set_frame_state(uint64_t frame, FrameState state) {
+    FrameState old = (FrameState)frame_state[frame];
+    if (old == state) return;
+    frame_state[frame] = state;
+    for (int o = 1; o <= max_order; o++) {
+        uint64_t block = frame >> order_bits[o];
+        if (block >= block_free[o].size()) continue;
+        if (old == FRAME_FREE) block_free[o][block]--;
+        else if (state == FRAME_FREE && ++block_free[o][block] == order_pages(o)) free_blocks[o].push_back(block);
+    }
+}
+
+bool VirtualMemory::take_free_frame(uint64_t& frame) {
+    // Frames a huge block took meanwhile are skipped here
+    while (!free_frames.empty() || fresh_frame < num_frames) {
+        uint64_t f;
+        if (!free_frames.empty()) {
+            f = free_frames.back();
+            free_frames.pop_back();
+        } else {
+            f = fresh_frame++;
+            grow_frames(f + 1);
+        }
+        if (frame_state[f] == FRAME_FREE) {
+            set_frame_state(f, FRAME_USED);
+            frame = f;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool VirtualMemory::take_free_block(int order, uint64_t& first_frame) {
+    auto& stack = free_blocks[order];
+    while (!stack.empty()) {
+        uint64_t block = stack.back();
+        stack.pop_back();
+        if (block_free[order][block] == order_pages(order)) {
+            first_frame = block << order_bits[order];
+            grow_frames(first_frame + order_pages(order));
+            return true;
+        }
+    }
+    return false;
+}
 
-    num_frames = physical_memory_size / page_size;
-    frame_owner.resize(num_frames, -1);
+void VirtualMemory::switch_process(uint16_t pid) {
+    auto it = processes.find(pid);
+    if (it == processes.end()) {
+        // Each pid's tables get their own physical span above RAM
+        Process* p = new Process(pid, page_number_bits, pt_levels,
+                                 table_base + ((uint64_t)pid << PROCESS_TABLE_SHIFT));
+        if (local_replacement) {
+            p->replacer = PageReplacer::create(page_policy, num_frames);
+            p->replacer->prefer_clean(&frame_dirty, clean_first_window);
+        }
+        it = processes.insert({pid, p}).first;
+        share_frames(*p);
+    }
+    if (current && current != it->second) context_switches++;
+    current = it->second;
 }
 
-int VirtualMemory::select_victim() {
-    if (replacement_policy == "FIFO") {
-        int victim = fifo_queue.front();
-        fifo_queue.pop();
-        return victim;
+// A newcomer starts with an equal share of RAM; fixed shares are rebalanced
+void VirtualMemory::share_frames(Process& newcomer) {
+    uint64_t share = num_frames / processes.size();
+    if (share == 0) share = 1;
+    if (allotment == ALLOT_FIXED) {
+        for (auto& entry : processes) entry.second->allotment = share;
+    } else {
+        newcomer.allotment = share;
     }
+}
 
-    // LRU
-    int victim = -1;
-    int oldest = INT_MAX;
+// The working set is the distinct pages of the last ws_window references;
+// under WS allotment that is exactly the share a process may keep
+void VirtualMemory::track_working_set(Process& p, uint64_t page) {
+    p.ws_refs.push_back(page);
+    p.ws_count[page]++;
+    if (p.ws_refs.size() > (size_t)ws_window) {
+        auto it = p.ws_count.find(p.ws_refs.front());
+        if (--it->second == 0) p.ws_count.erase(it);
+        p.ws_refs.pop_front();
+    }
+    p.allotment = p.ws_count.size() < num_frames ? p.ws_count.size() : num_frames;
+}
 
-    for (auto &p : page_table) {
-        if (p.second.valid && p.second.last_used < oldest) {
-            oldest = p.second.last_used;
-            victim = p.first;
+// A window of THRASH_WINDOW references thrashes when at least
+// THRASH_PERCENT of them fault; sampled per process and system-wide
+void VirtualMemory::sample_thrashing(Process& p, bool fault) {
+    const uint64_t limit = (uint64_t)THRASH_WINDOW * THRASH_PERCENT;
+    if (fault) {
+        p.window_faults++;
+        window_faults++;
+    }
+    if (p.references % THRASH_WINDOW == 0) {
+        p.windows++;
+        if (p.window_faults * 100 >= limit) p.thrash_windows++;
+        p.window_faults = 0;
+    }
+    if (++window_refs == THRASH_WINDOW) {
+        windows++;
+        if (window_faults * 100 >= limit) thrash_windows++;
+        window_refs = window_faults = 0;
+    }
+}
+
+// Under local replacement a process below its allotment takes its frame
+// from the one holding the largest fraction of its own allotment. When the
+// allotments over-commit RAM that shares it out in proportion to them,
+// which is as close as a trace replay gets to suspending a process.
+VirtualMemory::Process& VirtualMemory::allotment_victim() {
+    Process* victim = nullptr;
+    for (auto& entry : processes) {
+        Process* p = entry.second;
+        if (p->resident == 0) continue;
+        if (!victim) {
+            victim = p;
+            continue;
         }
+        uint64_t fill = p->resident * victim->allotment;
+        uint64_t victim_fill = victim->resident * p->allotment;
+        if (fill > victim_fill || (fill == victim_fill && p->resident > victim->resident)) victim = p;
     }
-    return victim;
+    return *victim;
 }
 
-void VirtualMemory::handle_page_fault(int page) {
-    disk_accesses++;
-    std::cout << "   [MMU] Page Fault! Virtual Page " << page << " is not in RAM." << std::endl;
+uint64_t VirtualMemory::take_frame(Process& p, uint64_t keep) {
+    uint64_t frame;
 
-    int frame = -1;
+    // Under local replacement a process at its allotment pays with its own
+    // pages even while RAM has room
+    bool own = local_replacement && p.resident > 0 && p.resident >= p.allotment;
+    if (!own) {
+        if (take_free_frame(frame)) {
+            MEMSIM_LOG(std::cout << "   [MMU] Found Free Frame " << frame << "." << std::endl);
+            return frame;
+        }
 
-    // find free frame
-    for (int i = 0; i < num_frames; i++) {
-        if (frame_owner[i] == -1) {
-            frame = i;
-            std::cout << "   [MMU] Found Free Frame " << frame << "." << std::endl;
-            break;
+        // Idle reserved frames go before anything resident is evicted
+        while (!reservation_queue.empty()) {
+            Process& holder = process(reservation_queue.front().first);
+            uint64_t first = reservation_queue.front().second;
+            reservation_queue.pop_front();
+            if (holder.reservations.count(first) == 0) continue;
+            break_reservation(holder, first);
+            if (take_free_frame(frame)) {
+                MEMSIM_LOG(std::cout << "   [MMU] Took Frame " << frame << " from a broken reservation." << std::endl);
+                return frame;
+            }
         }
     }
 
     // eviction needed
-    if (frame == -1) {
-        int victim_page = select_victim();
-        frame = page_table[victim_page].frame;
+    PageReplacer* victims = replacer;
+    if (local_replacement) victims = own ? p.replacer : allotment_victim().replacer;
+    frame = victims->select_victim();
+    if (keep != NO_PAGE && frame == keep) {
+        // The frame an access is still using goes back as the newest page;
+        // a replacer holding nothing else offers it again
+        victims->on_load(keep, frame_pid[keep], frame_owner[keep]);
+        frame = victims->select_victim();
+        if (frame == keep) {
+            victims->on_load(keep, frame_pid[keep], frame_owner[keep]);
+            return NO_PAGE;
+        }
+    }
+    if (frame == NO_PAGE) return NO_PAGE;       // Nothing resident to give up
+    evict_frame(frame);
+    return frame;
+}
+
+void VirtualMemory::evict_frame(uint64_t frame) {
+    Process& owner = process(frame_pid[frame]);
+    uint64_t victim_page = frame_owner[frame];
+
+    // Partial eviction of a huge page splits it first
+    if (frame_order[frame] > 0) demote(owner, victim_page, frame_order[frame]);
+    if (!frame_reservation.empty() && frame_reservation[frame] != NO_PAGE) break_reservation(owner, frame_reservation[frame]);
+    PageTableEntry* victim = owner.page_table.find(victim_page);
 
-        std::cout << "   [MMU] RAM FULL! Evicting Virtual Page " << victim_page 
-                  << " from Frame " << frame << " (" << replacement_policy << ")" << std::endl;
+    MEMSIM_LOG(std::cout << "   [MMU] RAM FULL! Evicting Virtual Page " << victim_page;
+               if (processes.size() > 1) std::cout << " of process " << owner.pid;
+               std::cout << " from Frame " << frame << " (" << replacement_policy << ")" << std::endl);
+    MEMSIM_EVENT(EV_EVICT, EVSRC_VM, victim_page, frame * page_size, frame);
 
-        page_table[victim_page].valid = false;
-        frame_owner[frame] = -1;
+    bool dirty = frame_dirty[frame] != 0;
+    if (dirty) dirty_evictions++;
+    else clean_evictions++;
+
+    if (zswap_capacity > 0 && compress(owner, victim_page, frame, dirty)) {
+        MEMSIM_LOG(std::cout << "   [MMU] Compressed the victim page into the pool." << std::endl);
+    } else if (dirty) {
+        // swap out before the frame can be reused
+        disk_writes++;
+        last_disk += disk_write_latency;
+        MEMSIM_EVENT(EV_WRITEBACK, EVSRC_VM, victim_page, frame * page_size, page_size);
+        MEMSIM_LOG(std::cout << "   [MMU] Victim page is dirty: writing it to swap." << std::endl);
     }
 
-    // load page
-    page_table[page] = {true, frame, timer};
+    victim->valid = false;
+    frame_owner[frame] = NO_PAGE;
+    frame_dirty[frame] = 0;
+    if (!frame_prefetched.empty() && frame_prefetched[frame]) {
+        frame_prefetched[frame] = 0;
+        ra_wasted++;
+    }
+    owner.resident--;
+    count_resident(owner, victim_page, -1);
+
+    // Shoot down any cached translation of the evicted page
+    if (dtlb) dtlb->invalidate(owner.pid, victim_page);
+    if (stlb) stlb->invalidate(owner.pid, victim_page);
+}
+
+void VirtualMemory::load(Process& p, uint64_t frame, uint64_t page) {
     frame_owner[frame] = page;
+    frame_pid[frame] = p.pid;
+    replacer_of(p)->on_load(frame, p.pid, page);
+    p.resident++;
+}
+
+// Keeps the resident-page count of fault-mode ranges, which may only be
+// mapped huge while none of their pages is resident
+void VirtualMemory::count_resident(Process& p, uint64_t page, int delta) {
+    if (huge_regions.empty()) return;
+    const PageRegion* region = region_of(page);
+    if (!region || region->promote) return;
+    uint64_t first = page & ~(order_pages(region->order) - 1);
+    if (!range_in(*region, first)) return;
+
+    if (delta > 0) {
+        p.range_resident[first] += delta;
+    } else {
+        auto it = p.range_resident.find(first);
+        if (it != p.range_resident.end() && --it->second == 0) p.range_resident.erase(it);
+    }
+}
+
+uint64_t VirtualMemory::reserved_frame(Process& p, uint64_t page, const PageRegion& region) {
+    uint64_t first = page & ~(order_pages(region.order) - 1);
+    if (!range_in(region, first)) return NO_PAGE;
+
+    auto it = p.reservations.find(first);
+    if (it == p.reservations.end()) {
+        uint64_t base;
+        if (!take_free_block(region.order, base)) return NO_PAGE;
+        for (uint64_t i = 0; i < order_pages(region.order); i++) {
+            set_frame_state(base + i, FRAME_RESERVED);
+            frame_reservation[base + i] = first;
+        }
+        it = p.reservations.insert({first, Reservation{base, 0, region.order}}).first;
+        reservation_queue.push_back({p.pid, first});
+    }
+
+    uint64_t frame = it->second.first_frame + (page - first);
+    set_frame_state(frame, FRAME_USED);
+    it->second.populated++;
+    MEMSIM_LOG(std::cout << "   [MMU] Using Reserved Frame " << frame << "." << std::endl);
+    return frame;
+}
+
+bool VirtualMemory::fault_huge(Process& p, uint64_t page, const PageRegion& region) {
+    int order = region.order;
+    uint64_t pages = order_pages(order);
+    uint64_t first = page & ~(pages - 1);
+    uint64_t base;
+    if (!range_in(region, first) || p.range_resident.count(first) || !take_free_block(order, base)) return false;
+
+    for (uint64_t i = 0; i < pages; i++) {
+        set_frame_state(base + i, FRAME_USED);
+        frame_order[base + i] = (uint8_t)order;
+        load(p, base + i, first + i);
+    }
+    p.page_table.map_huge(first, order) = {true, base};
+    p.range_resident[first] = pages;
+
+    // The whole huge page comes in from swap
+    faults_by_order[order]++;
+    disk_reads += pages;
+    disk_read_cycles += pages * disk_read_latency;
+    last_disk += pages * disk_read_latency;
+    MEMSIM_EVENT(EV_FAULT, EVSRC_VM, first, first * page_size, base);
+    MEMSIM_LOG(std::cout << "   [MMU] Loaded Virtual Pages " << first << "-" << first + pages - 1
+              << " as one " << (pages * page_size) << "-byte page at Frame " << base << std::endl);
+    return true;
+}
 
-    if (replacement_policy == "FIFO")
-        fifo_queue.push(page);
-        
-    std::cout << "   [MMU] Loaded Virtual Page " << page << " into Frame " << frame << std::endl;
+void VirtualMemory::break_reservation(Process& p, uint64_t first_page) {
+    auto it = p.reservations.find(first_page);
+    if (it == p.reservations.end()) return;
+    const Reservation& reservation = it->second;
+
+    // Frames never populated go back on the free stack, lowest on top
+    for (uint64_t i = order_pages(reservation.order); i-- > 0;) {
+        uint64_t frame = reservation.first_frame + i;
+        frame_reservation[frame] = NO_PAGE;
+        if (frame_state[frame] == FRAME_RESERVED) {
+            set_frame_state(frame, FRAME_FREE);
+            free_frames.push_back(frame);
+        }
+    }
+    p.reservations.erase(it);
+    reservations_broken++;
+}
+
+void VirtualMemory::promote(Process& p, uint64_t first_page) {
+    auto it = p.reservations.find(first_page);
+    Reservation reservation = it->second;
+    p.reservations.erase(it);
+
+    p.page_table.map_huge(first_page, reservation.order) = {true, reservation.first_frame};
+    for (uint64_t i = 0; i < order_pages(reservation.order); i++) {
+        frame_order[reservation.first_frame + i] = (uint8_t)reservation.order;
+        frame_reservation[reservation.first_frame + i] = NO_PAGE;
+    }
+    promotions[reservation.order]++;
+    MEMSIM_LOG(std::cout << "   [MMU] Promoted Virtual Pages " << first_page << "-"
+              << first_page + order_pages(reservation.order) - 1 << " to one "
+              << (order_pages(reservation.order) * page_size) << "-byte page." << std::endl);
+}
+
+void VirtualMemory::demote(Process& p, uint64_t page, int order) {
+    uint64_t first = page & ~(order_pages(order) - 1);
+    uint64_t base = p.page_table.find(first)->frame;
+
+    p.page_table.split_huge(first, order);
+    for (uint64_t i = 0; i < order_pages(order); i++) {
+        p.page_table.map(first + i) = {true, base + i};
+        frame_order[base + i] = 0;
+    }
+    if (dtlb) dtlb->invalidate(p.pid, first);
+    if (stlb) stlb->invalidate(p.pid, first);
+    demotions[order]++;
+    MEMSIM_LOG(std::cout << "   [MMU] Split the " << (order_pages(order) * page_size) << "-byte page at Virtual Page "
+              << first << " to evict part of it." << std::endl);
+}
+
+bool VirtualMemory::handle_page_fault(uint64_t page) {
+    Process& p = *current;
+    MEMSIM_LOG(std::cout << "   [MMU] Page Fault! Virtual Page " << page << " is not in RAM." << std::endl);
+
+    // PFF: the time since the last fault decides whether the share grows
+    if (local_replacement && allotment == ALLOT_PFF) {
+        uint64_t interval = p.references - p.last_fault;
+        if (interval < (uint64_t)pff_low && p.allotment < num_frames) p.allotment++;
+        else if (interval > (uint64_t)pff_high && p.allotment > 1) p.allotment--;
+        p.last_fault = p.references;
+    }
+
+    const PageRegion* region = huge_regions.empty() ? nullptr : region_of(page);
+    if (region && !region->promote && fault_huge(p, page, *region)) return true;
+
+    bool dirty = false;
+    if (zswap_capacity > 0 && decompress(p, page, dirty)) {
+        last_disk += zswap_latency;
+    } else {
+        disk_reads++;
+        disk_read_cycles += disk_read_latency;
+        last_disk += disk_read_latency;
+        if (readahead_mode != READAHEAD_OFF && !region) plan_readahead(p, page);
+    }
+
+    uint64_t frame = NO_PAGE;
+    if (region && region->promote) frame = reserved_frame(p, page, *region);
+    if (frame == NO_PAGE) frame = take_frame(p);
+    if (frame == NO_PAGE) {
+        MEMSIM_LOG(std::cout << "   [MMU] No frame can take Virtual Page " << page << "." << std::endl);
+        ra_count = 0;
+        return false;
+    }
+
+    // load page
+    p.page_table.map(page) = {true, frame};
+    load(p, frame, page);
+    frame_dirty[frame] = dirty;
+    faults_by_order[0]++;
+    count_resident(p, page, 1);
+
+    MEMSIM_EVENT(EV_FAULT, EVSRC_VM, page, page * page_size, frame);
+    MEMSIM_LOG(std::cout << "   [MMU] Loaded Virtual Page " << page << " into Frame " << frame << std::endl);
+
+    // A range whose reservation is now fully populated becomes one page
+    if (!frame_reservation.empty() && frame_reservation[frame] != NO_PAGE) {
+        uint64_t first = frame_reservation[frame];
+        const Reservation& reservation = p.reservations.at(first);
+        if (reservation.populated == order_pages(reservation.order)) promote(p, first);
+    }
+    return true;
+}
+
+// Sampled pages are sized by the order-0 entropy of their bytes, and a
+// page of one repeated byte is stored as that byte alone, as zswap does.
+// A page the allocator never wrote (all zero) gets the fixed ratio.
+uint64_t VirtualMemory::compressed_size(uint64_t frame) const {
+    uint64_t fixed = (uint64_t)std::ceil(page_size / zswap_ratio);
+    uint64_t start = frame * page_size;
+    if (!zswap_sample || !memory || start + page_size > memory->size()) return fixed;
+    if (!memory->isCommitted(start, page_size)) return fixed;
+
+    vector<unsigned char> bytes(page_size);
+    memory->read(start, bytes.data(), page_size);
+    uint32_t counts[256] = {0};
+    for (int i = 0; i < page_size; i++) counts[bytes[i]]++;
+    if (counts[0] == (uint32_t)page_size) return fixed;
+    if (counts[bytes[0]] == (uint32_t)page_size) return 0;
+
+    double bits = 0;
+    for (int b = 0; b < 256; b++) {
+        if (counts[b] == 0) continue;
+        double share = (double)counts[b] / page_size;
+        bits -= counts[b] * std::log2(share);
+    }
+    return (uint64_t)std::ceil(bits / 8);
+}
+
+// Stores an evicted page; false sends it to swap instead. Pages of
+// fault-mode huge ranges always go to swap, since they come back as one
+// huge page read.
+bool VirtualMemory::compress(Process& p, uint64_t page, uint64_t frame, bool dirty) {
+    const PageRegion* region = huge_regions.empty() ? nullptr : region_of(page);
+    if (region && !region->promote) return false;
+
+    uint64_t bytes = compressed_size(frame);
+    if (bytes >= (uint64_t)page_size || bytes > zswap_capacity) {
+        zswap_rejects++;
+        return false;
+    }
+    while (pool_bytes + bytes > zswap_capacity) {
+        if (!zswap_writeback) {
+            zswap_rejects++;
+            return false;
+        }
+        write_back_oldest();
+    }
+
+    pool.push_back({p.pid, page, bytes, dirty});
+    p.compressed[page] = std::prev(pool.end());
+    pool_bytes += bytes;
+    zswap_stores++;
+    if (bytes == 0) zswap_same_filled++;
+    return true;
+}
+
+// A hit takes the page out of the pool; dirty says whether its swap copy is stale
+bool VirtualMemory::decompress(Process& p, uint64_t page, bool& dirty) {
+    auto it = p.compressed.find(page);
+    if (it == p.compressed.end()) return false;
+
+    dirty = it->second->dirty;
+    pool_bytes -= it->second->bytes;
+    pool.erase(it->second);
+    p.compressed.erase(it);
+    zswap_hits++;
+    MEMSIM_LOG(std::cout << "   [MMU] Found Virtual Page " << page << " in the compressed pool." << std::endl);
+    return true;
+}
+
+void VirtualMemory::write_back_oldest() {
+    const CompressedPage& oldest = pool.front();
+    if (oldest.dirty) {
+        disk_writes++;
+        last_disk += disk_write_latency;
+        MEMSIM_EVENT(EV_WRITEBACK, EVSRC_VM, oldest.page, num_frames * page_size, page_size);
+    }
+    process(oldest.pid).compressed.erase(oldest.page);
+    pool_bytes -= oldest.bytes;
+    pool.pop_front();
+    zswap_writebacks++;
+}
+
+// Window sizes follow Linux's get_init_ra_size() / get_next_ra_size():
+// start at four pages, then quadruple while small and double after
+uint64_t VirtualMemory::next_window(uint64_t size) const {
+    uint64_t next;
+    if (size == 0) next = 4;
+    else if (size < readahead_pages / 16) next = size * 4;
+    else if (size <= readahead_pages / 2) next = size * 2;
+    else next = readahead_pages;
+    return next < readahead_pages ? next : readahead_pages;
 }
-int VirtualMemory::translate(int virtual_address) {
-    timer++;
 
-    int page = virtual_address / page_size;
-    int offset = virtual_address % page_size;
+// Decides what a fault on page reads in with it. Adaptive readahead only
+// starts a window when the fault continues a sequential stream; its first
+// page is the marker that reads the following window asynchronously.
+void VirtualMemory::plan_readahead(Process& p, uint64_t page) {
+    ra_next = page + 1;
+    ra_async = false;
+    if (readahead_mode == READAHEAD_FIXED) {
+        ra_count = readahead_pages;
+        return;
+    }
+
+    bool sequential = (p.ra_prev != NO_PAGE && page == p.ra_prev + 1) ||
+                      (p.ra_size > 0 && page == p.ra_start + p.ra_size);
+    p.ra_prev = page;
+    if (!sequential) {
+        p.ra_size = 0;
+        p.ra_marker = NO_PAGE;
+        return;
+    }
+    p.ra_start = page + 1;
+    p.ra_size = next_window(p.ra_size);
+    p.ra_marker = p.ra_start;
+    ra_count = p.ra_size;
+}
+
+void VirtualMemory::use_prefetched(Process& p, uint64_t page, uint64_t frame) {
+    frame_prefetched[frame] = 0;
+    ra_used++;
+    if (readahead_mode != READAHEAD_ADAPTIVE) return;
+
+    p.ra_prev = page;
+    if (page == p.ra_marker) {
+        p.ra_start += p.ra_size;
+        p.ra_size = next_window(p.ra_size);
+        p.ra_marker = p.ra_start;
+        ra_next = p.ra_start;
+        ra_count = p.ra_size;
+        ra_async = true;
+    }
+}
+
+// Reads the planned pages as one batch: a seek plus a transfer per page. It
+// stops at the first page already resident or outside paged memory. It runs
+// after the translation into in_use, which its evictions must pass over:
+// under local replacement the batch only fills the rest of the allotment,
+// and a shared replacer that offers in_use is asked again. An asynchronous
+// batch overlaps the stream and is not charged to the access.
+void VirtualMemory::readahead(Process& p, uint64_t in_use) {
+    uint64_t last_page = page_number_bits < 64 ? ((uint64_t)1 << page_number_bits) - 1 : UINT64_MAX;
+    uint64_t limit = ra_count;
+    if (local_replacement) {
+        uint64_t room = p.allotment > p.resident ? p.allotment - p.resident : 0;
+        if (room < limit) limit = room;
+    }
+    uint64_t count = 0;
+    for (; count < limit; count++) {
+        uint64_t page = ra_next + count;
+        if (page < ra_next || page > last_page || (!huge_regions.empty() && region_of(page))) break;
+        PageTableEntry* pte = p.page_table.find(page);
+        if ((pte && pte->valid) || p.compressed.count(page)) break;
+
+        uint64_t frame = take_frame(p, in_use);
+        if (frame == NO_PAGE) break;
+        p.page_table.map(page) = {true, frame};
+        load(p, frame, page);
+        frame_prefetched[frame] = 1;
+    }
+    ra_count = 0;
+    if (count == 0) return;
+
+    uint64_t cycles = count * readahead_page_latency;
+    if (ra_async) cycles += disk_read_latency;
+    disk_reads += count;
+    disk_read_cycles += cycles;
+    ra_pages += count;
+    ra_batches++;
+    if (ra_async) {
+        ra_async_batches++;
+        ra_overlapped_cycles += cycles;
+    } else {
+        last_disk += cycles;
+    }
+    MEMSIM_LOG(std::cout << "   [MMU] Read ahead Virtual Pages " << ra_next << "-" << ra_next + count - 1
+              << (ra_async ? " (async)" : "") << std::endl);
+}
+
+bool VirtualMemory::translate(uint64_t virtual_address, uint64_t& physical_address, bool is_write) {
+    Process& p = *current;
+    PageTable& page_table = p.page_table;
+    last_cycles = 0;
+    last_disk = 0;
+    if (virtual_address_bits < 64 && (virtual_address >> virtual_address_bits) != 0) {
+        page_table.clear_walk_refs();
+        address_errors++;
+        MEMSIM_LOG(std::cout << "   [MMU] Address 0x" << std::hex << virtual_address << std::dec
+                  << " is outside the " << virtual_address_bits << "-bit address space." << std::endl);
+        return false;
+    }
+    page_table.clear_walk_refs();
 
-    if (page_table.count(page) && page_table[page].valid) {
+    uint64_t page = virtual_address >> offset_bits;
+    uint64_t offset = virtual_address & (page_size - 1);
+    uint64_t frame;
+    p.references++;
+    if (allotment == ALLOT_WS) track_working_set(p, page);
+
+    // TLB hierarchy: DTLB, then STLB (refilling the DTLB on a hit)
+    bool tlb_hit = false;
+    int order = 0;
+    if (dtlb) {
+        last_cycles += dtlb->getLatency();
+        tlb_hit = dtlb->lookup(p.pid, page, frame, order);
+    }
+    if (!tlb_hit && stlb) {
+        last_cycles += stlb->getLatency();
+        tlb_hit = stlb->lookup(p.pid, page, frame, order);
+        if (tlb_hit && dtlb) dtlb->insert(p.pid, page, frame, order);
+    }
+    if (tlb_hit) {
+        // The OS still sees the reference for its replacement policy
+        page_hits++;
+        p.hits++;
+        hits_by_order[order]++;
+        replacer_of(p)->on_access(frame);
+        sample_thrashing(p, false);
+        if (is_write) frame_dirty[frame] = 1;
+        if (!frame_prefetched.empty() && frame_prefetched[frame]) use_prefetched(p, page, frame);
+        physical_address = frame * page_size + offset;
+        translation_cycles += last_cycles;
+        if (ra_count > 0) readahead(p, frame);
+        return true;
+    }
+
+    PageTableEntry* pte = page_table.walk(page, &order);
+    if (pte) {
         page_hits++;
-        page_table[page].last_used = timer;
-        return page_table[page].frame * page_size + offset;
+        p.hits++;
+        hits_by_order[order]++;
+        frame = pte->frame + (page & (order_pages(order) - 1));
+        replacer_of(p)->on_access(frame);
+        sample_thrashing(p, false);
+        if (!frame_prefetched.empty() && frame_prefetched[frame]) use_prefetched(p, page, frame);
+    } else {
+        // page fault; the faulting access walks again once the page is in
+        page_faults++;
+        p.faults++;
+        if (!handle_page_fault(page)) return false;
+        sample_thrashing(p, true);
+        pte = page_table.walk(page, &order);
+        frame = pte->frame + (page & (order_pages(order) - 1));
     }
 
-    // page fault
-    page_faults++;
-    handle_page_fault(page);
+    if (is_write) frame_dirty[frame] = 1;
+    if (dtlb) dtlb->insert(p.pid, page, frame, order);
+    if (stlb) stlb->insert(p.pid, page, frame, order);
+    if (!walks_to_cache) last_cycles += (uint64_t)page_table.last_walk_refs().size() * walk_latency;
+    translation_cycles += last_cycles;
 
-    return page_table[page].frame * page_size + offset;
+    physical_address = frame * page_size + offset;
+    if (ra_count > 0) readahead(p, frame);
+    return true;
 }
 
 void VirtualMemory::stats() const {
     cout << "Page hits: " << page_hits << "\n";
     cout << "Page faults: " << page_faults << "\n";
-    cout << "Disk accesses: " << disk_accesses << "\n";
+    cout << "Disk accesses: " << disk_reads + disk_writes << "\n";
+    cout << "Disk reads: " << disk_reads << " (" << disk_read_cycles << " cycles), writes: "
+         << disk_writes << " (" << disk_writes * disk_write_latency << " cycles)\n";
+    cout << "Evictions: " << clean_evictions << " clean, " << dirty_evictions << " dirty\n";
 
-    int total = page_hits + page_faults;
+    uint64_t total = page_hits + page_faults;
     if (total > 0) {
         cout << "Page fault rate: "
              << (double)page_faults / total * 100 << "%\n";
     }
+
+    // Every process's tables share one geometry
+    const PageTable& geometry = current->page_table;
+    uint64_t tables = 0, table_bytes = 0, walks = 0, walk_refs = 0, open_reservations = 0;
+    for (const auto& entry : processes) {
+        const Process& p = *entry.second;
+        tables += p.page_table.table_pages();
+        table_bytes += p.page_table.table_bytes();
+        walks += p.page_table.walk_count();
+        walk_refs += p.page_table.walk_ref_count();
+        open_reservations += p.reservations.size();
+    }
+    cout << "Page table: " << geometry.level_count() << " levels (";
+    for (int l = 0; l < geometry.level_count(); l++) {
+        cout << (l ? "/" : "") << geometry.bits_at(l);
+    }
+    cout << " index bits), " << tables << " tables, " << table_bytes << " bytes\n";
+    cout << "Page walks: " << walks << " (" << walk_refs << " memory references)\n";
+    if (dtlb) dtlb->showStats();
+    if (stlb) stlb->showStats();
+    if (dtlb || stlb) {
+        cout << "Translation cycles: " << translation_cycles
+             << (walks_to_cache ? " (TLB only; walks charged by the caches)" : " (TLB + page walks)") << "\n";
+    }
+    if (!huge_regions.empty()) {
+        for (int o = 0; o <= max_order; o++) {
+            cout << (o == 0 ? "Page sizes: " : "            ") << order_pages(o) * page_size << " B: "
+                 << hits_by_order[o] << " hits, " << faults_by_order[o] << " faults";
+            if (o > 0) cout << ", " << promotions[o] << " promotions, " << demotions[o] << " demotions";
+            cout << "\n";
+        }
+        cout << "Huge-page reservations: " << open_reservations << " open, " << reservations_broken << " broken\n";
+    }
+    if (zswap_capacity > 0) {
+        cout << "Compressed pool: " << pool_bytes << " of " << zswap_capacity << " bytes, " << pool.size()
+             << " pages, saving " << pool.size() * page_size - pool_bytes << " bytes\n";
+        cout << "Compressed pool: " << zswap_hits << " hits";
+        if (page_faults > 0) cout << " (" << (double)zswap_hits / page_faults * 100 << "% of faults)";
+        cout << ", " << zswap_stores << " stored (" << zswap_same_filled << " same-filled), " << zswap_writebacks << " written back, "
+             << zswap_rejects << " rejected\n";
+    }
+    if (readahead_mode != READAHEAD_OFF) {
+        cout << "Readahead: " << (readahead_mode == READAHEAD_FIXED ? "fixed " : "adaptive up to ")
+             << readahead_pages << " pages, " << ra_batches << " batches (" << ra_async_batches << " async, "
+             << ra_overlapped_cycles << " cycles overlapped), " << ra_pages << " pages read ahead: "
+             << ra_used << " used, " << ra_wasted << " evicted unused\n";
+    }
+    if (processes.size() > 1 || local_replacement) process_stats();
+    if (address_errors > 0) {
+        cout << "Out-of-range addresses: " << address_errors << "\n";
+    }
+}
+
+void VirtualMemory::process_stats() const {
+    cout << "Processes: " << processes.size() << " (" << (local_replacement ? "local" : "global") << " replacement";
+    if (local_replacement) cout << ", " << allotment_name(allotment) << " allotment";
+    cout << "), " << context_switches << " context switches\n";
+
+    uint64_t demand = 0;
+    for (const auto& entry : processes) {
+        const Process& p = *entry.second;
+        uint64_t total = p.hits + p.faults;
+        cout << "  pid " << p.pid << ": " << total << " references, " << p.faults << " faults";
+        if (total > 0) cout << " (" << (double)p.faults / total * 100 << "%)";
+        cout << ", " << p.resident << " resident";
+        if (local_replacement) cout << " of " << p.allotment << " allotted";
+        if (allotment == ALLOT_WS) cout << ", working set " << p.ws_count.size();
+        cout << ", thrashing in " << p.thrash_windows << "/" << p.windows << " windows\n";
+        demand += p.ws_count.size();
+    }
+
+    cout << "Thrashing: " << thrash_windows << " of " << windows << " windows of " << THRASH_WINDOW
+         << " references faulted on " << THRASH_PERCENT << "% or more";
+    if (allotment == ALLOT_WS && demand > num_frames)
+        cout << "; working sets need " << demand << " of " << num_frames << " frames";
+    cout << "\n";
 }
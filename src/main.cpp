@@ -1,149 +1,1056 @@
 #include "../include/MemoryManager.h"
 #include "../include/BuddyAllocator.h"
+#include "../include/TlsfAllocator.h"
+#include "../include/SlabAllocator.h"
+#include "../include/ArenaAllocator.h"
+#include "../include/ConcurrentHeap.h"
 #include "../include/Cache.h"
-#include "../include/virtualmemory.h" 
+#include "../include/VirtualMemory.h"
+#include "../include/TraceReader.h"
+#include "../include/EventLog.h"
+#include "../include/StackDistance.h"
+#include "../include/BitOps.h"
+#include "../include/SweepGrid.h"
 #include <iostream>
+#include <iomanip>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+// Everything the REPL commands operate on
+struct Simulator {
+    size_t memorySize;
+    VmConfig vmConfig;
+
+    MemoryManager* memSim;
+    CacheController* cacheSim;
+    VirtualMemory* vm;
+
+    // LRU stack-distance profiles of the lines the caches see and of the
+    // virtual pages referenced (mrc on); nullptr when off
+    StackDistance* lineProfile;
+    StackDistance* pageProfile;
+    int lineShift;
+    int pageShift;
+};
 
 void printHelp() {
     std::cout << "\n--- Available Commands ---\n";
     std::cout << "  init <size>              : Initialize physical memory size\n";
-    std::cout << "  config cache <L1|L2> ... : Configure Cache (ex: config cache L1 2048 64 2)\n";
-    std::cout << "  set allocator <type>     : Set allocator (first, best, worst, buddy)\n";
-    std::cout << "  set policy <type>        : Set VM replacement policy (FIFO, LRU)\n";
+    std::cout << "  config cache <L1|L2> ... : Configure Cache (ex: config cache L1 2048 64 2 [policy] [seed])\n";
+    std::cout << "                             policies: LRU, FIFO, PLRU, SRRIP, BRRIP, NRU, RANDOM\n";
+    std::cout << "  config prefetch <L1|L2|L3> <kind> [degree] [distance] : Hardware prefetcher for a level\n";
+    std::cout << "                             kinds: off, next-line, stride, stream, spatial (distance = region lines)\n";
+    std::cout << "  config cores <n> [mesi|moesi] : Private L1/L2 per core, shared L3, coherent (default 1 core)\n";
+    std::cout << "  config parallel <threads|off> : Simulate the caches on worker threads, split by set (1 core, quiet)\n";
+    std::cout << "  config vm <va> <page> <levels> [on|off] : Page table geometry; on = walks go through the caches\n";
+    std::cout << "  config hugepage <start> <len> <huge|giant> [fault|promote] : Huge-page region (off clears)\n";
+    std::cout << "  config swap <read> <write> [window] : Page-in / write-back cycles; window > 0 prefers clean victims\n";
+    std::cout << "  config tlb <L1|L2> <entries> <assoc> [policy] [latency] : TLB level (config tlb walk <cycles> | off)\n";
+    std::cout << "  config zswap <bytes> <ratio|sample> [cycles] [writeback|reject] : Compressed pool carved out of RAM (off)\n";
+    std::cout << "  config readahead <off|fixed|adaptive> [pages] [cycles] : Pages read in with a fault, batched\n";
+    std::cout << "  config process <global|local> [fixed|pff <low> <high>|ws <window>] : Replacement scope and frame allotment\n";
+    std::cout << "  set allocator <type>     : Set allocator (first, best, worst, buddy, tlsf, slab, arena)\n";
+    std::cout << "  set policy <type>        : Set VM replacement policy (FIFO, LRU, CLOCK, SECOND-CHANCE, CLOCK-PRO)\n";
     std::cout << "  malloc <size>            : Allocate virtual memory block\n";
+    std::cout << "  arena <begin|reset>      : Open a nested arena / free everything in it at once\n";
     std::cout << "  free <id>                : Free memory block\n";
-    std::cout << "  read <virtual_addr>      : Read Address (Access)\n";
-    std::cout << "  write <virtual_addr>     : Write Address (Sets Dirty Bit)\n";
+    std::cout << "  read <virtual_addr> [@c] : Read Address (Access), on core c if given\n";
+    std::cout << "  write <virtual_addr> [@c]: Write Address (Sets Dirty Bit)\n";
+    std::cout << "  core <c>                 : Run later references on core c\n";
+    std::cout << "  tlb flush [asid]         : Invalidate all TLB entries, or one address space's\n";
+    std::cout << "  as <pid>                 : Switch to process pid (its own page table and ASID)\n";
     std::cout << "  stats                    : Show All Stats\n";
+    std::cout << "  mrc on [line] [rate]     : LRU miss-ratio curves of every cache size and frame count, in one pass\n";
+    std::cout << "                             (rate < 1 samples lines/pages; mrc csv <file> exports, mrc off stops)\n";
+    std::cout << "  concurrent run <threads> <ops> [remote%] [seed] : Drive the heap from worker threads\n";
+    std::cout << "  set verbosity <level>    : quiet, events (log only) or verbose\n";
+    std::cout << "  log <file> [text|binary] : Record structured events to a file (log off to stop)\n";
     std::cout << "  exit                     : Exit\n";
     std::cout << "--------------------------\n";
 }
 
-int main() {
-    size_t memorySize = 1024; 
-    int pageSize = 64;        
-    int vaBits = 16;          
-
-    MemoryManager* memSim = new MemoryManager(memorySize); 
-    CacheController* cacheSim = new CacheController();
-    VirtualMemory* vm = new VirtualMemory(vaBits, pageSize, memorySize, "FIFO");
-
-    std::cout << "System Initialized." << std::endl;
-    printHelp();
-
-    std::string commandLine;
-    while (true) {
-        std::cout << "\n> ";
-        if (!std::getline(std::cin, commandLine)) break;
-        
-        std::stringstream ss(commandLine);
-        std::string cmd;
-        ss >> cmd;
-
-        if (cmd == "exit") break;
-        else if (cmd == "help") printHelp();
-        
-        else if (cmd == "init") {
-            size_t size;
-            if (ss >> size) {
-                memorySize = size;
-                delete memSim; memSim = new MemoryManager(memorySize);
-                delete vm; vm = new VirtualMemory(vaBits, pageSize, memorySize, "FIFO");
-                std::cout << "Memory initialized to " << size << " bytes." << std::endl;
-            }
-        }
-        // --- NEW: CONFIG CACHE COMMAND ---
-        else if (cmd == "config") {
-            std::string subCmd;
-            ss >> subCmd;
-            if (subCmd == "cache") {
-                std::string level;
-                size_t size, blk;
-                int assoc;
-                // Default policy is LRU for simplicity in CLI
-                if (ss >> level >> size >> blk >> assoc) {
-                    cacheSim->configCache(level, size, blk, assoc, "LRU");
+void printUsage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--trace <file>] [--format auto|native|din|lackey] [-c \"<command>\"]...\n"
+              << "              [--log <file>] [--log-format text|binary] [--verbosity quiet|events|verbose]\n"
+              << "              [--mrc <file>] [--sweep <grid file> [--jobs <n>]]\n"
+              << "  --trace <file>      Replay a trace non-interactively and print only the final stats\n"
+              << "  --format <fmt>      Trace format (default: auto-detect)\n"
+              << "  -c <command>        Run a REPL command before the trace / prompt (repeatable)\n"
+              << "  --log <file>        Record hit/miss/evict/writeback/fault/alloc events\n"
+              << "  --log-format <fmt>  Event log encoding (default: text)\n"
+              << "  --verbosity <level> Default: verbose for the REPL, quiet (or events with --log) for traces\n"
+              << "  --sweep <file>      Replay the trace once per configuration in a grid file, in parallel\n"
+              << "  --jobs <n>          Sweep threads (default: one per hardware thread)\n"
+              << "  --mrc <file>        Profile miss-ratio curves (mrc on unless a -c set it up) and write them as CSV\n";
+}
+
+void printStats(Simulator& sim) {
+    std::cout << "=== MEMORY ALLOCATOR STATS ===" << std::endl;
+    sim.memSim->showStats();
+    std::cout << "\n=== VIRTUAL MEMORY STATS ===" << std::endl;
+    sim.vm->stats();
+    std::cout << "\n=== CACHE STATS ===" << std::endl;
+    sim.cacheSim->showStats();
+    if (sim.lineProfile) {
+        std::cout << "\n=== LRU MISS-RATIO CURVES ===" << std::endl;
+        sim.lineProfile->showStats("Cache lines", (uint64_t)1 << sim.lineShift);
+        sim.pageProfile->showStats("Pages", (uint64_t)1 << sim.pageShift);
+    }
+}
+
+// Starts both profiles empty. Lines and pages are keyed at the sizes in
+// force now; later config changes do not re-key them.
+void startProfiles(Simulator& sim, size_t lineSize, double sampleRate) {
+    delete sim.lineProfile;
+    delete sim.pageProfile;
+    sim.lineProfile = new StackDistance(sampleRate);
+    sim.pageProfile = new StackDistance(sampleRate);
+    sim.lineShift = findFirstSet(lineSize);
+    sim.pageShift = findFirstSet(sim.vmConfig.page_size);
+}
+
+void stopProfiles(Simulator& sim) {
+    delete sim.lineProfile;
+    delete sim.pageProfile;
+    sim.lineProfile = nullptr;
+    sim.pageProfile = nullptr;
+}
+
+// One row per capacity: "cache" rows count lines, "vm" rows count frames
+bool writeProfiles(const Simulator& sim, const std::string& path) {
+    FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) return false;
+    std::fprintf(out, "curve,capacity,bytes,miss_ratio,misses\n");
+    sim.lineProfile->writeCsv(out, "cache", (uint64_t)1 << sim.lineShift);
+    sim.pageProfile->writeCsv(out, "vm", (uint64_t)1 << sim.pageShift);
+    std::fclose(out);
+    return true;
+}
+
+// Rebuilds the VM from vmConfig, letting its compressed pool sample the heap
+void rebuildVm(Simulator& sim) {
+    delete sim.vm;
+    sim.vm = new VirtualMemory(sim.vmConfig);
+    sim.vm->sample_memory(&sim.memSim->memoryContents());
+}
+
+// A simulator with the defaults every session starts from
+void buildSimulator(Simulator& sim) {
+    sim.memorySize = 1024;
+    // A 48-bit, x86-64 style address space, so real traces translate as-is
+    sim.vmConfig.va_bits = 48;
+    sim.vmConfig.page_size = 64;
+    sim.vmConfig.phys_mem_size = sim.memorySize;
+    sim.vmConfig.policy = "FIFO";
+    sim.vmConfig.pt_levels = 4;
+    sim.vmConfig.walks_to_cache = false;
+    // TLBs are off until configured; these are the shapes "config tlb" starts from
+    sim.vmConfig.dtlb = {0, 4, POLICY_LRU, 1};
+    sim.vmConfig.stlb = {0, 8, POLICY_LRU, 8};
+    sim.vmConfig.walk_latency = 100;
+    sim.vmConfig.disk_read_latency = 10000;
+    sim.vmConfig.disk_write_latency = 20000;
+    sim.vmConfig.clean_first_window = 0;
+    sim.vmConfig.local_replacement = false;
+    sim.vmConfig.allotment = ALLOT_FIXED;
+    sim.vmConfig.pff_low = 100;
+    sim.vmConfig.pff_high = 1000;
+    sim.vmConfig.ws_window = 1000;
+    sim.vmConfig.readahead = READAHEAD_OFF;
+    sim.vmConfig.readahead_pages = 32;
+    sim.vmConfig.readahead_page_latency = 1000;
+    sim.vmConfig.zswap_bytes = 0;
+    sim.vmConfig.zswap_ratio = 3.0;
+    sim.vmConfig.zswap_sample = false;
+    sim.vmConfig.zswap_latency = 2000;
+    sim.vmConfig.zswap_writeback = true;
+
+    sim.memSim = new MemoryManager(sim.memorySize);
+    sim.cacheSim = new CacheController();
+    sim.vm = nullptr;
+    rebuildVm(sim);
+    sim.lineProfile = nullptr;
+    sim.pageProfile = nullptr;
+}
+
+void destroySimulator(Simulator& sim) {
+    stopProfiles(sim);
+    delete sim.vm;
+    delete sim.cacheSim;
+    delete sim.memSim;
+}
+
+// Sends a translated reference down the cache hierarchy, preceded by the
+// page-walk reads when those are modelled, and charges the translation and
+// any swap traffic
+inline void sendToCaches(Simulator& sim, uint64_t physicalAddr, bool isWrite) {
+    if (sim.vm->models_translation()) {
+        if (sim.vmConfig.walks_to_cache) {
+            for (uint64_t pteAddr : sim.vm->last_walk_refs()) sim.cacheSim->accessPageWalk(pteAddr);
+        }
+        sim.cacheSim->chargeTranslation(sim.vm->last_translation_cycles());
+    }
+    sim.cacheSim->chargeSwap(sim.vm->last_disk_cycles());
+    sim.cacheSim->accessMemory(physicalAddr, isWrite);
+
+    if (sim.lineProfile) {
+        if (sim.vm->models_translation() && sim.vmConfig.walks_to_cache) {
+            for (uint64_t pteAddr : sim.vm->last_walk_refs()) sim.lineProfile->access(pteAddr >> sim.lineShift);
+        }
+        sim.lineProfile->access(physicalAddr >> sim.lineShift);
+    }
+}
+
+// Page numbers can fill 64 bits, leaving no room for the ASID beside them:
+// it is XORed into a bijective mix (murmur3's finaliser) of the page
+// instead, so one process's pages never collide and two processes' only
+// when their mixes differ in nothing but the ASID bits.
+inline void profilePage(Simulator& sim, uint64_t virtualAddr) {
+    if (!sim.pageProfile) return;
+    uint64_t key = virtualAddr >> sim.pageShift;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    sim.pageProfile->access(key ^ sim.vm->asid());
+}
+
+// Translates one virtual reference and sends it down the cache hierarchy.
+// Addresses outside the virtual address space are dropped.
+inline void accessAddress(Simulator& sim, uint64_t virtualAddr, bool isWrite) {
+    uint64_t physicalAddr;
+    if (!sim.vm->translate(virtualAddr, physicalAddr, isWrite)) return;
+    profilePage(sim, virtualAddr);
+    sendToCaches(sim, physicalAddr, isWrite);
+}
+
+// Runs one REPL command line. Returns false when the session should end.
+bool executeCommand(Simulator& sim, const std::string& commandLine) {
+    std::stringstream ss(commandLine);
+    std::string cmd;
+    ss >> cmd;
+
+    if (cmd == "exit") return false;
+    else if (cmd == "help") printHelp();
+
+    else if (cmd == "init") {
+        size_t size;
+        if (ss >> size) {
+            VmConfig config = sim.vmConfig;
+            config.phys_mem_size = size;
+            config.policy = "FIFO";
+            const char* error = VirtualMemory::config_error(config);
+            if (error) {
+                std::cout << "Invalid memory size: " << error << std::endl;
+                return true;
+            }
+            sim.memorySize = size;
+            delete sim.memSim; sim.memSim = new MemoryManager(sim.memorySize);
+            sim.vmConfig = config;
+            rebuildVm(sim);
+            std::cout << "Memory initialized to " << size << " bytes." << std::endl;
+        }
+    }
+    // --- NEW: CONFIG CACHE COMMAND ---
+    else if (cmd == "config") {
+        std::string subCmd;
+        ss >> subCmd;
+        if (subCmd == "cache") {
+            std::string level, policy = "LRU";
+            size_t size, blk;
+            int assoc;
+            unsigned seed = 1;
+            if (ss >> level >> size >> blk >> assoc) {
+                ss >> policy >> seed;
+                sim.cacheSim->configCache(level, size, blk, assoc, policy, seed);
+            } else {
+                std::cout << "Usage: config cache <Level> <Size> <BlockSize> <Assoc> [policy] [seed]" << std::endl;
+            }
+        }
+        else if (subCmd == "prefetch") {
+            std::string level, kindName;
+            PrefetcherKind kind;
+            if (ss >> level >> kindName && Prefetcher::parseKind(kindName, kind)) {
+                PrefetchConfig config = Prefetcher::defaults(kind);
+                ss >> config.degree >> config.distance;
+                if (sim.cacheSim->configPrefetch(level, config)) {
+                    if (kind == PREFETCH_OFF) {
+                        std::cout << level << " prefetcher off" << std::endl;
+                    } else {
+                        std::cout << level << " prefetcher: " << Prefetcher::kindName(kind) << ", degree "
+                                  << config.degree << ", distance " << config.distance << std::endl;
+                    }
+                }
+            } else {
+                std::cout << "Usage: config prefetch <L1|L2|L3> <off|next-line|stride|stream|spatial> [degree] [distance]"
+                          << std::endl;
+            }
+        }
+        else if (subCmd == "cores") {
+            int count = 0;
+            std::string protocol = "mesi";
+            if (ss >> count) {
+                ss >> protocol;
+                if (sim.cacheSim->configCores(count, protocol)) {
+                    std::cout << "Caches: " << count << " cores with private L1/L2 and a shared L3"
+                              << (count > 1 ? ", " + protocol + " coherence" : "") << std::endl;
+                }
+            } else {
+                std::cout << "Usage: config cores <count> [mesi|moesi]" << std::endl;
+            }
+        }
+        else if (subCmd == "parallel") {
+            std::string arg;
+            ss >> arg;
+            int threads = 0;
+            bool valid = !arg.empty();
+            if (valid && arg != "off") {
+                try { threads = std::stoi(arg); } catch (...) { valid = false; }
+                valid = valid && threads > 0;
+            }
+            if (!valid) {
+                std::cout << "Usage: config parallel <threads> | config parallel off" << std::endl;
+            } else if (sim.cacheSim->configParallel(threads)) {
+                if (sim.cacheSim->getParallelThreads() > 0) {
+                    std::cout << "Caches: simulated on " << threads << " threads, split by set (caches emptied)" << std::endl;
+                } else {
+                    std::cout << "Caches: simulated serially" << std::endl;
+                }
+            }
+        }
+        else if (subCmd == "vm") {
+            VmConfig config = sim.vmConfig;
+            std::string walks = sim.vmConfig.walks_to_cache ? "on" : "off";
+            if (ss >> config.va_bits >> config.page_size >> config.pt_levels) {
+                ss >> walks;
+                const char* error = VirtualMemory::config_error(config);
+                config.walks_to_cache = (walks == "on");
+                if (error) {
+                    std::cout << "Invalid VM configuration: " << error << std::endl;
+                } else {
+                    sim.vmConfig = config;
+                    rebuildVm(sim);
+                    std::cout << "VM: " << config.va_bits << "-bit VA, " << config.page_size << "-byte pages, "
+                              << config.pt_levels << "-level page table, walks "
+                              << (config.walks_to_cache ? "through caches" : "not cached") << std::endl;
+                }
+            } else {
+                std::cout << "Usage: config vm <VA bits> <PageSize> <Levels 2-4> [walks-to-cache on|off]" << std::endl;
+            }
+        }
+        else if (subCmd == "hugepage") {
+            VmConfig config = sim.vmConfig;
+            std::string startStr, lengthStr, size, mode = "fault";
+            ss >> startStr;
+            if (startStr == "off") {
+                config.huge_regions.clear();
+            } else if (ss >> lengthStr >> size && (size == "huge" || size == "giant")) {
+                ss >> mode;
+                HugeRegion region;
+                try {
+                    region.start = std::stoull(startStr, nullptr, 0);
+                    region.length = std::stoull(lengthStr, nullptr, 0);
+                } catch (...) {
+                    std::cout << "Invalid address." << std::endl;
+                    return true;
+                }
+                region.order = (size == "huge") ? 1 : 2;
+                region.promote = (mode == "promote");
+                config.huge_regions.push_back(region);
+            } else {
+                std::cout << "Usage: config hugepage <start> <length> <huge|giant> [fault|promote] | config hugepage off" << std::endl;
+                return true;
+            }
+
+            const char* error = VirtualMemory::config_error(config);
+            if (error) {
+                std::cout << "Invalid huge-page region: " << error << std::endl;
+            } else {
+                sim.vmConfig = config;
+                rebuildVm(sim);
+                std::cout << "Huge-page regions: " << config.huge_regions.size() << std::endl;
+            }
+        }
+        else if (subCmd == "swap") {
+            VmConfig config = sim.vmConfig;
+            if (ss >> config.disk_read_latency >> config.disk_write_latency) {
+                ss >> config.clean_first_window;
+                const char* error = VirtualMemory::config_error(config);
+                if (error) {
+                    std::cout << "Invalid swap configuration: " << error << std::endl;
                 } else {
-                    std::cout << "Usage: config cache <Level> <Size> <BlockSize> <Assoc>" << std::endl;
+                    sim.vmConfig = config;
+                    rebuildVm(sim);
+                    std::cout << "Swap: read " << config.disk_read_latency << " cycles, write "
+                              << config.disk_write_latency << " cycles, clean-first ";
+                    if (config.clean_first_window > 0) std::cout << "window " << config.clean_first_window << std::endl;
+                    else std::cout << "off" << std::endl;
                 }
+            } else {
+                std::cout << "Usage: config swap <read cycles> <write cycles> [clean-first window, 0 = off]" << std::endl;
             }
         }
-        else if (cmd == "set") {
-            std::string subCmd, type;
-            ss >> subCmd >> type;
-
-            if (subCmd == "allocator") {
-                delete memSim;
-                if (type == "buddy") memSim = new BuddyAllocator(memorySize);
-                else { memSim = new MemoryManager(memorySize); memSim->setAllocator(type); }
-                std::cout << "Allocator: " << type << std::endl;
-            } 
-            else if (subCmd == "policy") {
-                if (type == "FIFO" || type == "fifo") type = "FIFO";
-                else if (type == "LRU" || type == "lru") type = "LRU";
-
-                if (type == "FIFO" || type == "LRU") {
-                    delete vm;
-                    vm = new VirtualMemory(vaBits, pageSize, memorySize, type);
-                    std::cout << "VM Policy set to: " << type << std::endl;
+        else if (subCmd == "zswap") {
+            VmConfig config = sim.vmConfig;
+            std::string size, ratio, full;
+            ss >> size;
+            bool valid = true;
+            if (size == "off") {
+                config.zswap_bytes = 0;
+            } else {
+                try {
+                    config.zswap_bytes = std::stoull(size, nullptr, 0);
+                    valid = config.zswap_bytes > 0 && static_cast<bool>(ss >> ratio);
+                    if (valid) {
+                        // "sample" keeps the previous fixed ratio for pages the heap never wrote
+                        config.zswap_sample = (ratio == "sample");
+                        if (!config.zswap_sample) config.zswap_ratio = std::stod(ratio);
+                        if (ss >> config.zswap_latency && ss >> full) {
+                            if (full == "writeback") config.zswap_writeback = true;
+                            else if (full == "reject") config.zswap_writeback = false;
+                            else valid = false;
+                        }
+                    }
+                } catch (...) { valid = false; }
+            }
+
+            const char* error = valid ? VirtualMemory::config_error(config) : nullptr;
+            if (!valid) {
+                std::cout << "Usage: config zswap <pool bytes> <ratio|sample> [decompress cycles] [writeback|reject] | config zswap off" << std::endl;
+            } else if (error) {
+                std::cout << "Invalid zswap configuration: " << error << std::endl;
+            } else {
+                sim.vmConfig = config;
+                rebuildVm(sim);
+                std::cout << "Compressed pool: ";
+                if (config.zswap_bytes == 0) {
+                    std::cout << "off" << std::endl;
                 } else {
-                    std::cout << "Invalid Policy." << std::endl;
+                    std::cout << config.zswap_bytes << " bytes, ";
+                    if (config.zswap_sample) std::cout << "sampled ratio, ";
+                    else std::cout << "ratio " << config.zswap_ratio << ", ";
+                    std::cout << config.zswap_latency << " cycles per decompression, "
+                              << (config.zswap_writeback ? "writes back" : "rejects") << " when full" << std::endl;
                 }
-            } 
+            }
         }
+        else if (subCmd == "readahead") {
+            VmConfig config = sim.vmConfig;
+            std::string mode;
+            ss >> mode;
+            bool valid = true;
+            if (mode == "off") {
+                config.readahead = READAHEAD_OFF;
+            } else if (mode == "fixed" || mode == "adaptive") {
+                config.readahead = (mode == "fixed") ? READAHEAD_FIXED : READAHEAD_ADAPTIVE;
+                valid = static_cast<bool>(ss >> config.readahead_pages);
+                ss >> config.readahead_page_latency;
+            } else {
+                valid = false;
+            }
 
-        else if (cmd == "malloc") {
-            size_t size;
-            if (ss >> size) memSim->allocate(size);
+            const char* error = valid ? VirtualMemory::config_error(config) : nullptr;
+            if (!valid) {
+                std::cout << "Usage: config readahead off | config readahead <fixed|adaptive> <pages> [cycles per extra page]" << std::endl;
+            } else if (error) {
+                std::cout << "Invalid readahead configuration: " << error << std::endl;
+            } else {
+                sim.vmConfig = config;
+                rebuildVm(sim);
+                std::cout << "Readahead: ";
+                if (config.readahead == READAHEAD_OFF) std::cout << "off" << std::endl;
+                else std::cout << mode << ", " << config.readahead_pages << " pages, "
+                               << config.readahead_page_latency << " cycles per extra page in a batch" << std::endl;
+            }
         }
-        else if (cmd == "free") {
-            int id;
-            if (ss >> id) memSim->deallocate(id);
+        else if (subCmd == "process") {
+            VmConfig config = sim.vmConfig;
+            std::string scope, allotment;
+            ss >> scope >> allotment;
+            bool valid = true;
+            if (scope == "global") {
+                config.local_replacement = false;
+                config.allotment = ALLOT_FIXED;
+            } else if (scope == "local") {
+                config.local_replacement = true;
+                if (allotment.empty() || allotment == "fixed") {
+                    config.allotment = ALLOT_FIXED;
+                } else if (allotment == "pff") {
+                    config.allotment = ALLOT_PFF;
+                    if (ss >> config.pff_low) valid = static_cast<bool>(ss >> config.pff_high);
+                } else if (allotment == "ws") {
+                    config.allotment = ALLOT_WS;
+                    ss >> config.ws_window;
+                } else {
+                    valid = false;
+                }
+            } else {
+                valid = false;
+            }
+
+            const char* error = valid ? VirtualMemory::config_error(config) : nullptr;
+            if (!valid) {
+                std::cout << "Usage: config process global | config process local [fixed | pff <low> <high> | ws <window>]" << std::endl;
+            } else if (error) {
+                std::cout << "Invalid process configuration: " << error << std::endl;
+            } else {
+                sim.vmConfig = config;
+                rebuildVm(sim);
+                std::cout << "Replacement: ";
+                if (!config.local_replacement) std::cout << "global" << std::endl;
+                else if (config.allotment == ALLOT_PFF)
+                    std::cout << "local, PFF allotment (grow below " << config.pff_low << ", shrink above "
+                              << config.pff_high << " references between faults)" << std::endl;
+                else if (config.allotment == ALLOT_WS)
+                    std::cout << "local, working-set allotment over " << config.ws_window << " references" << std::endl;
+                else std::cout << "local, fixed equal allotment" << std::endl;
+            }
         }
-        else if (cmd == "dump") {
-            memSim->dumpMemory();
+        else if (subCmd == "tlb") {
+            VmConfig config = sim.vmConfig;
+            std::string level;
+            ss >> level;
+            bool valid = true;
+            if (level == "off") {
+                config.dtlb.entries = 0;
+                config.stlb.entries = 0;
+            } else if (level == "walk") {
+                valid = static_cast<bool>(ss >> config.walk_latency);
+            } else if (level == "L1" || level == "L2") {
+                TlbConfig& tlb = (level == "L1") ? config.dtlb : config.stlb;
+                std::string policy = "LRU";
+                valid = static_cast<bool>(ss >> tlb.entries >> tlb.associativity);
+                ss >> policy >> tlb.latency;
+                if (valid && !CacheLevel::parsePolicy(policy, tlb.policy)) {
+                    std::cout << "Invalid TLB Policy: " << policy << std::endl;
+                    return true;
+                }
+            } else {
+                valid = false;
+            }
+
+            const char* error = valid ? VirtualMemory::config_error(config) : nullptr;
+            if (!valid) {
+                std::cout << "Usage: config tlb <L1|L2> <entries> <assoc> [policy] [latency] | config tlb walk <cycles> | config tlb off" << std::endl;
+            } else if (error) {
+                std::cout << "Invalid TLB configuration: " << error << std::endl;
+            } else {
+                sim.vmConfig = config;
+                rebuildVm(sim);
+                std::cout << "TLB: ";
+                if (config.dtlb.entries > 0) std::cout << "L1 " << config.dtlb.entries << " entries " << config.dtlb.associativity << "-way, ";
+                else std::cout << "no L1, ";
+                if (config.stlb.entries > 0) std::cout << "L2 " << config.stlb.entries << " entries " << config.stlb.associativity << "-way, ";
+                else std::cout << "no L2, ";
+                std::cout << "walk " << config.walk_latency << " cycles per page-table read" << std::endl;
+            }
         }
+    }
+    else if (cmd == "set") {
+        std::string subCmd, type;
+        ss >> subCmd >> type;
 
-        // --- READ / WRITE COMMANDS ---
-        else if (cmd == "read" || cmd == "access") {
-            std::string addrStr;
-            if (ss >> addrStr) {
-                try {
-                    int virtualAddr = std::stoi(addrStr, nullptr, 0);
-                    int physicalAddr = vm->translate(virtualAddr);
-                    std::cout << "      -> Phys Addr: 0x" << std::hex << physicalAddr << std::dec << std::endl;
-                    // Pass isWrite = false
-                    cacheSim->accessMemory(physicalAddr, false); 
-                } catch (...) { std::cout << "Invalid address." << std::endl; }
+        if (subCmd == "allocator") {
+            delete sim.memSim;
+            if (type == "buddy") sim.memSim = new BuddyAllocator(sim.memorySize);
+            else if (type == "tlsf") sim.memSim = new TlsfAllocator(sim.memorySize);
+            else if (type == "slab") sim.memSim = new SlabAllocator(sim.memorySize);
+            else if (type == "arena") sim.memSim = new ArenaAllocator(sim.memorySize);
+            else { sim.memSim = new MemoryManager(sim.memorySize); sim.memSim->setAllocator(type); }
+            sim.vm->sample_memory(&sim.memSim->memoryContents());
+            std::cout << "Allocator: " << type << std::endl;
+        }
+        else if (subCmd == "policy") {
+            PagePolicy policy;
+            if (PageReplacer::parse_policy(type, policy)) {
+                type = PageReplacer::policy_name(policy);
+                sim.vmConfig.policy = type;
+                rebuildVm(sim);
+                std::cout << "VM Policy set to: " << type << std::endl;
+            } else {
+                std::cout << "Invalid Policy." << std::endl;
             }
         }
-        else if (cmd == "write") {
-            std::string addrStr;
-            if (ss >> addrStr) {
-                try {
-                    int virtualAddr = std::stoi(addrStr, nullptr, 0);
-                    int physicalAddr = vm->translate(virtualAddr);
+        else if (subCmd == "verbosity") {
+            int level;
+            if (EventLog::parseVerbosity(type, level) && level != VERBOSITY_QUIET &&
+                sim.cacheSim->getParallelThreads() > 0) {
+                std::cout << "Parallel cache simulation runs quiet: config parallel off first" << std::endl;
+            } else if (EventLog::parseVerbosity(type, level)) {
+                EventLog::verbosity = level;
+                std::cout << "Verbosity set to: " << EventLog::verbosityName(level) << std::endl;
+            } else {
+                std::cout << "Usage: set verbosity <quiet|events|verbose>" << std::endl;
+            }
+        }
+    }
+    else if (cmd == "log") {
+        std::string path, encoding = "text";
+        ss >> path >> encoding;
+        if (path == "off") {
+            EventLog::closeLog();
+            std::cout << "Event log closed." << std::endl;
+        } else if (path.empty() || (encoding != "text" && encoding != "binary")) {
+            std::cout << "Usage: log <file> [text|binary] | log off" << std::endl;
+        } else if (sim.cacheSim->getParallelThreads() > 0) {
+            std::cout << "Parallel cache simulation runs quiet: config parallel off first" << std::endl;
+        } else if (EventLog::openLog(path, encoding == "binary")) {
+            // A log is pointless at quiet level, so opening one implies events
+            if (EventLog::verbosity == VERBOSITY_QUIET) EventLog::verbosity = VERBOSITY_EVENTS;
+            std::cout << "Logging events to " << path << " (" << encoding << ")" << std::endl;
+        } else {
+            std::cout << "Error: cannot open " << path << std::endl;
+        }
+    }
+
+    else if (cmd == "malloc") {
+        size_t size;
+        if (ss >> size) sim.memSim->allocate(size);
+    }
+    else if (cmd == "free") {
+        int id;
+        if (ss >> id) sim.memSim->deallocate(id);
+    }
+    else if (cmd == "arena") {
+        std::string subCmd;
+        ss >> subCmd;
+        ArenaAllocator* arena = dynamic_cast<ArenaAllocator*>(sim.memSim);
+        if (!arena) std::cout << "Error: arena commands need 'set allocator arena'." << std::endl;
+        else if (subCmd == "begin") arena->beginArena();
+        else if (subCmd == "reset") arena->resetArena();
+        else std::cout << "Usage: arena <begin|reset>" << std::endl;
+    }
+    else if (cmd == "dump") {
+        sim.memSim->dumpMemory();
+    }
+
+    // --- READ / WRITE COMMANDS ---
+    else if (cmd == "read" || cmd == "access" || cmd == "write") {
+        std::string addrStr, coreStr;
+        if (ss >> addrStr) {
+            try {
+                uint64_t virtualAddr = std::stoull(addrStr, nullptr, 0);
+                if (ss >> coreStr && coreStr[0] == '@' && !sim.cacheSim->selectCore(std::stoi(coreStr.substr(1)))) {
+                    std::cout << "No such core: " << coreStr.substr(1) << std::endl;
+                    return true;
+                }
+                uint64_t physicalAddr;
+                uint64_t addressErrors = sim.vm->address_error_count();
+                if (sim.vm->translate(virtualAddr, physicalAddr, cmd == "write")) {
                     std::cout << "      -> Phys Addr: 0x" << std::hex << physicalAddr << std::dec << std::endl;
-                    // Pass isWrite = true
-                    cacheSim->accessMemory(physicalAddr, true); 
-                } catch (...) { std::cout << "Invalid address." << std::endl; }
+                    profilePage(sim, virtualAddr);
+                    // Only "write" sets the dirty bit
+                    sendToCaches(sim, physicalAddr, cmd == "write");
+                } else if (sim.vm->address_error_count() != addressErrors) {
+                    std::cout << "Segmentation fault: address outside the virtual address space." << std::endl;
+                } else {
+                    std::cout << "Out of memory: no frame can be freed for the page." << std::endl;
+                }
+            } catch (...) { std::cout << "Invalid address." << std::endl; }
+        }
+    }
+
+    else if (cmd == "tlb") {
+        std::string subCmd;
+        int asid = -1;
+        ss >> subCmd >> asid;
+        if (subCmd != "flush") {
+            std::cout << "Usage: tlb flush [asid]" << std::endl;
+        } else if (asid >= 0) {
+            sim.vm->flush_tlb((uint16_t)asid);
+            std::cout << "TLB entries of ASID " << asid << " flushed." << std::endl;
+        } else {
+            sim.vm->flush_tlb();
+            std::cout << "TLB flushed." << std::endl;
+        }
+    }
+    else if (cmd == "core") {
+        int core = -1;
+        ss >> core;
+        if (sim.cacheSim->selectCore(core)) {
+            std::cout << "Running on core " << core << "." << std::endl;
+        } else {
+            std::cout << "Usage: core <0-" << sim.cacheSim->coreCount() - 1 << ">" << std::endl;
+        }
+    }
+    else if (cmd == "as") {
+        int pid = -1;
+        ss >> pid;
+        if (pid < 0 || pid > 0xFFFF) {
+            std::cout << "Usage: as <pid 0-65535>" << std::endl;
+        } else {
+            sim.vm->switch_process((uint16_t)pid);
+            std::cout << "Running as process " << pid << " (" << sim.vm->process_count() << " processes)." << std::endl;
+        }
+    }
+    else if (cmd == "stats") {
+        printStats(sim);
+    }
+    else if (cmd == "mrc") {
+        std::string subCmd, arg;
+        ss >> subCmd >> arg;
+        if (subCmd == "on") {
+            size_t lineSize = 64;
+            double sampleRate = 1.0;
+            bool valid = true;
+            try {
+                if (!arg.empty()) lineSize = std::stoull(arg, nullptr, 0);
+                if (ss >> sampleRate) valid = sampleRate > 0.0 && sampleRate <= 1.0;
+            } catch (...) { valid = false; }
+            if (!valid || lineSize == 0 || (lineSize & (lineSize - 1))) {
+                std::cout << "Usage: mrc on [line bytes, a power of two] [sample rate 0-1]" << std::endl;
+            } else {
+                startProfiles(sim, lineSize, sampleRate);
+                std::cout << "Profiling LRU miss-ratio curves: " << lineSize << "-byte lines, "
+                          << sim.vmConfig.page_size << "-byte pages";
+                if (sampleRate < 1.0) std::cout << ", sampling " << sampleRate * 100 << "% of them";
+                std::cout << std::endl;
             }
         }
+        else if (subCmd == "off") {
+            stopProfiles(sim);
+            std::cout << "Miss-ratio profiling off." << std::endl;
+        }
+        else if (subCmd == "csv" && !arg.empty()) {
+            if (!sim.lineProfile) std::cout << "No profile: mrc on first" << std::endl;
+            else if (writeProfiles(sim, arg)) std::cout << "Miss-ratio curves written to " << arg << std::endl;
+            else std::cout << "Error: cannot open " << arg << std::endl;
+        }
+        else {
+            std::cout << "Usage: mrc on [line bytes] [sample rate] | mrc csv <file> | mrc off" << std::endl;
+        }
+    }
+    else if (cmd == "concurrent") {
+        std::string subCmd;
+        int threads = 0, remotePct = 10;
+        long ops = 0;
+        unsigned seed = 1;
+        ss >> subCmd >> threads >> ops;
+        if (subCmd == "run" && threads > 0 && ops > 0) {
+            ss >> remotePct >> seed;
+            ConcurrentHeap heap(sim.memSim, threads);
+            heap.run(ops, remotePct, seed);
+            heap.showStats();
+        } else {
+            std::cout << "Usage: concurrent run <threads> <ops> [remote%] [seed]" << std::endl;
+        }
+    }
+    return true;
+}
+
+// Replays one trace record other than a command
+inline void replayRecord(Simulator& sim, TraceOp op, unsigned long long value, int core,
+                         unsigned long long& missingCore) {
+    switch (op) {
+        case TRACE_READ:
+        case TRACE_WRITE:
+            // "@<core>" moves this and later references to that core
+            if (core >= 0 && !sim.cacheSim->selectCore(core)) {
+                missingCore++;
+                break;
+            }
+            accessAddress(sim, value, op == TRACE_WRITE);
+            break;
+        case TRACE_MALLOC:
+            sim.memSim->allocate((size_t)value);
+            break;
+        case TRACE_FREE:
+            sim.memSim->deallocate((int)value);
+            break;
+        case TRACE_SWITCH:
+            sim.vm->switch_process((uint16_t)value);
+            break;
+        case TRACE_COMMAND:
+            break;
+    }
+}
+
+// Batch mode: stream a whole trace through the simulator with no prompt,
+// then print the final stats block.
+int runTrace(Simulator& sim, const std::string& path, TraceFormat format) {
+    TraceReader reader(path, format);
+    if (!reader.isOpen()) {
+        std::cerr << "Error: cannot open trace file " << path << std::endl;
+        return 1;
+    }
+
+    // Keep acknowledgements of setup lines (init, set ...) off the console
+    std::streambuf* consoleBuf = std::cout.rdbuf(nullptr);
+
+    TraceRecord rec;
+    bool running = true;
+    unsigned long long missingCore = 0;
+    while (running && reader.next(rec)) {
+        if (rec.op == TRACE_COMMAND) running = executeCommand(sim, rec.command);
+        else replayRecord(sim, rec.op, rec.value, rec.core, missingCore);
+    }
+    std::cout.rdbuf(consoleBuf);
+    std::cout.clear();
+
+    if (reader.getSkippedLines() > 0) {
+        std::cerr << "Warning: skipped " << reader.getSkippedLines() << " unparsable trace lines" << std::endl;
+    }
+    if (missingCore > 0) {
+        std::cerr << "Warning: skipped " << missingCore << " references on cores not configured" << std::endl;
+    }
+    if (sim.vm->address_error_count() > 0) {
+        std::cerr << "Warning: skipped " << sim.vm->address_error_count() << " references outside the "
+                  << sim.vmConfig.va_bits << "-bit address space" << std::endl;
+    }
+    printStats(sim);
+    return 0;
+}
+
+// ---------------- Parameter sweep ----------------
 
-        else if (cmd == "stats") {
-            std::cout << "=== MEMORY ALLOCATOR STATS ===" << std::endl;
-            memSim->showStats();
-            std::cout << "\n=== VIRTUAL MEMORY STATS ===" << std::endl;
-            vm->stats();
-            std::cout << "\n=== CACHE STATS ===" << std::endl;
-            cacheSim->showStats();
+struct SweepResult {
+    std::vector<std::string> labels;    // The point's choice on each axis
+    double hitRate[3];
+    double amat;
+    uint64_t faults;
+    uint64_t pageReferences;
+    uint64_t addressErrors;
+};
+
+// log and set verbosity change state every simulator shares, so a sweep
+// leaves them out
+bool sharedStateCommand(const std::string& commandLine) {
+    std::stringstream ss(commandLine);
+    std::string cmd, subCmd;
+    ss >> cmd >> subCmd;
+    return cmd == "log" || (cmd == "set" && subCmd == "verbosity");
+}
+
+// Builds point index of the grid on a simulator of its own and replays the
+// decoded trace through it. Commands take consoleLock: they print their
+// acknowledgements to the (detached) shared console.
+void runSweepPoint(const SweepGrid& grid, size_t index, const std::vector<std::string>& setupCommands,
+                   const DecodedTrace& trace, std::mutex& consoleLock, SweepResult& result,
+                   std::atomic<unsigned long long>& skipped) {
+    std::vector<std::string> commands;
+    grid.point(index, commands, result.labels);
+    commands.insert(commands.begin(), setupCommands.begin(), setupCommands.end());
+
+    Simulator sim;
+    bool running = true;
+    unsigned long long missingCore = 0;
+    {
+        std::lock_guard<std::mutex> guard(consoleLock);
+        buildSimulator(sim);
+        for (const auto& line : commands) {
+            if (sharedStateCommand(line)) skipped++;
+            else if (running) running = executeCommand(sim, line);
+        }
+    }
+    for (const DecodedRecord& rec : trace.records) {
+        if (!running) break;
+        if (rec.op != TRACE_COMMAND) {
+            replayRecord(sim, rec.op, rec.value, rec.core, missingCore);
+            continue;
+        }
+        const std::string& line = trace.commands[rec.value];
+        if (sharedStateCommand(line)) {
+            skipped++;
+            continue;
         }
+        std::lock_guard<std::mutex> guard(consoleLock);
+        running = executeCommand(sim, line);
+    }
+
+    for (int l = 0; l < 3; l++) result.hitRate[l] = sim.cacheSim->hitRate(l + 1);
+    result.amat = sim.cacheSim->amat();
+    result.faults = sim.vm->fault_count();
+    result.pageReferences = sim.vm->reference_count();
+    result.addressErrors = sim.vm->address_error_count();
+    destroySimulator(sim);
+}
+
+// Decodes the trace once and replays it under every configuration of the
+// grid, jobs simulators at a time, then prints one row per configuration
+int runSweep(const std::string& tracePath, TraceFormat format, const std::vector<std::string>& setupCommands,
+             const std::string& gridPath, int jobs) {
+    SweepGrid grid;
+    std::string error;
+    if (!grid.load(gridPath, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+    DecodedTrace trace;
+    if (!trace.load(tracePath, format)) {
+        std::cerr << "Error: cannot open trace file " << tracePath << std::endl;
+        return 1;
+    }
+
+    size_t points = grid.pointCount();
+    if (jobs <= 0) jobs = (int)std::thread::hardware_concurrency();
+    jobs = (int)std::max<size_t>(1, std::min<size_t>(jobs, points));
+
+    std::vector<SweepResult> results(points);
+    std::atomic<size_t> nextPoint(0);
+    std::atomic<unsigned long long> skipped(0);
+    std::mutex consoleLock;
+    std::streambuf* consoleBuf = std::cout.rdbuf(nullptr);
+    std::vector<std::thread> workers;
+    for (int j = 0; j < jobs; j++) {
+        workers.push_back(std::thread([&]() {
+            for (size_t p; (p = nextPoint++) < points;) {
+                runSweepPoint(grid, p, setupCommands, trace, consoleLock, results[p], skipped);
+            }
+        }));
     }
+    for (auto& worker : workers) worker.join();
+    std::cout.rdbuf(consoleBuf);
+    std::cout.clear();
 
-    delete vm;
-    delete cacheSim;
-    delete memSim;
+    if (trace.skippedLines > 0) {
+        std::cerr << "Warning: skipped " << trace.skippedLines << " unparsable trace lines" << std::endl;
+    }
+    uint64_t addressErrors = 0;
+    for (const auto& result : results) addressErrors += result.addressErrors;
+    if (addressErrors > 0) {
+        std::cerr << "Warning: skipped " << addressErrors << " references outside the configured address space"
+                  << " (summed over configurations)" << std::endl;
+    }
+    if (skipped > 0) {
+        std::cerr << "Warning: ignored " << skipped << " log/verbosity commands; a sweep runs quiet" << std::endl;
+    }
+
+    // Axis columns fit their widest choice
+    std::vector<size_t> widths;
+    for (size_t a = 0; a < grid.axisCount(); a++) {
+        size_t width = std::max<size_t>(grid.axisName(a).size(), 6);
+        for (const auto& result : results) width = std::max(width, result.labels[a].size());
+        widths.push_back(width);
+    }
+
+    std::cout << "=== SWEEP: " << points << " configurations, " << trace.records.size() << " trace records, "
+              << jobs << " threads ===" << std::endl;
+    for (size_t a = 0; a < widths.size(); a++) {
+        std::string name = grid.axisName(a).empty() ? "axis " + std::to_string(a + 1) : grid.axisName(a);
+        std::cout << std::left << std::setw(widths[a]) << name << "  ";
+    }
+    std::cout << std::right << std::setw(7) << "L1 Hit%" << std::setw(9) << "L2 Hit%" << std::setw(9) << "L3 Hit%"
+              << std::setw(12) << "AMAT" << std::setw(12) << "Faults" << std::setw(9) << "Fault%" << std::endl;
+    for (const auto& result : results) {
+        for (size_t a = 0; a < widths.size(); a++) {
+            std::cout << std::left << std::setw(widths[a]) << result.labels[a] << "  ";
+        }
+        double faultRate = result.pageReferences ? (double)result.faults / result.pageReferences * 100.0 : 0.0;
+        std::cout << std::right << std::fixed << std::setprecision(2) << std::setw(7) << result.hitRate[0]
+                  << std::setw(9) << result.hitRate[1] << std::setw(9) << result.hitRate[2]
+                  << std::setw(12) << result.amat << std::setw(12) << result.faults
+                  << std::setw(9) << faultRate << std::endl;
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+    std::string tracePath;
+    TraceFormat traceFormat = TRACE_AUTO;
+    std::vector<std::string> setupCommands;
+    std::string logPath;
+    std::string mrcPath;
+    std::string gridPath;
+    int jobs = 0;
+    bool binaryLog = false;
+    int verbosity = -1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--format" && i + 1 < argc) {
+            if (!TraceReader::parseFormat(argv[++i], traceFormat)) {
+                std::cerr << "Unknown trace format: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "-c" && i + 1 < argc) {
+            setupCommands.push_back(argv[++i]);
+        } else if (arg == "--sweep" && i + 1 < argc) {
+            gridPath = argv[++i];
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            jobs = std::atoi(argv[++i]);
+        } else if (arg == "--mrc" && i + 1 < argc) {
+            mrcPath = argv[++i];
+        } else if (arg == "--log" && i + 1 < argc) {
+            logPath = argv[++i];
+        } else if (arg == "--log-format" && i + 1 < argc) {
+            std::string enc = argv[++i];
+            if (enc != "text" && enc != "binary") {
+                std::cerr << "Unknown log format: " << enc << std::endl;
+                return 1;
+            }
+            binaryLog = (enc == "binary");
+        } else if (arg == "--verbosity" && i + 1 < argc) {
+            if (!EventLog::parseVerbosity(argv[++i], verbosity)) {
+                std::cerr << "Unknown verbosity: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    bool batch = !tracePath.empty();
+
+    if (!gridPath.empty()) {
+        // Points run side by side, so nothing may narrate or log
+        if (!batch || !logPath.empty() || !mrcPath.empty() || verbosity > VERBOSITY_QUIET) {
+            std::cerr << "Error: --sweep needs --trace and runs quiet, without --log or --mrc" << std::endl;
+            return 1;
+        }
+        EventLog::verbosity = VERBOSITY_QUIET;
+        return runSweep(tracePath, traceFormat, setupCommands, gridPath, jobs);
+    }
+
+    if (!logPath.empty() && !EventLog::openLog(logPath, binaryLog)) {
+        std::cerr << "Error: cannot open log file " << logPath << std::endl;
+        return 1;
+    }
+    if (verbosity < 0) {
+        if (!batch) verbosity = VERBOSITY_VERBOSE;
+        else verbosity = logPath.empty() ? VERBOSITY_QUIET : VERBOSITY_EVENTS;
+    }
+    EventLog::verbosity = verbosity;
+
+    std::streambuf* consoleBuf = nullptr;
+    if (batch) consoleBuf = std::cout.rdbuf(nullptr);
+
+    Simulator sim;
+    buildSimulator(sim);
+    for (const auto& line : setupCommands) executeCommand(sim, line);
+    if (!mrcPath.empty() && !sim.lineProfile) startProfiles(sim, 64, 1.0);
+
+    int status = 0;
+    if (batch) {
+        std::cout.rdbuf(consoleBuf);
+        std::cout.clear();
+        status = runTrace(sim, tracePath, traceFormat);
+    } else {
+        std::cout << "System Initialized." << std::endl;
+        printHelp();
+
+        std::string commandLine;
+        while (true) {
+            std::cout << "\n> ";
+            if (!std::getline(std::cin, commandLine)) break;
+            if (!executeCommand(sim, commandLine)) break;
+        }
+    }
+
+    if (!mrcPath.empty() && sim.lineProfile && !writeProfiles(sim, mrcPath)) {
+        std::cerr << "Error: cannot write miss-ratio curves to " << mrcPath << std::endl;
+        status = 1;
+    }
+
+    destroySimulator(sim);
+    EventLog::closeLog();
+    return status;
+}
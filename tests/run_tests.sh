@@ -0,0 +1,66 @@
+#!/bin/sh
+# Regression checks run by make check: each feeds REPL commands to memsim
+# and looks for a line of its output.
+MEMSIM=${MEMSIM:-./memsim}
+failed=0
+
+# expect <name> <fixed string the output must contain> <commands...>
+expect() {
+    name=$1
+    want=$2
+    shift 2
+    out=$(printf '%s\n' "$@" exit | "$MEMSIM" 2>&1)
+    if printf '%s\n' "$out" | grep -qF -- "$want"; then
+        echo "ok   $name"
+    else
+        echo "FAIL $name: no \"$want\" in the output"
+        failed=1
+    fi
+}
+
+# expect_trace <name> <fixed string> <format> <trace lines...>: replays the
+# lines as a trace file instead
+expect_trace() {
+    name=$1
+    want=$2
+    format=$3
+    shift 3
+    trace=$(mktemp)
+    printf '%s\n' "$@" > "$trace"
+    out=$("$MEMSIM" --trace "$trace" --format "$format" 2>&1)
+    rm -f "$trace"
+    if printf '%s\n' "$out" | grep -qF -- "$want"; then
+        echo "ok   $name"
+    else
+        echo "FAIL $name: no \"$want\" in the output"
+        failed=1
+    fi
+}
+
+# Readahead under local replacement must not evict the page that faulted
+expect "readahead keeps the faulting page (local)" "Page hits: 1" \
+    "init 4096" "config process local fixed" "config readahead fixed 32" "as 1" "read 0" "read 0" "stats"
+expect "readahead fills only the allotment" "Disk reads: 32 " \
+    "init 4096" "config process local fixed" "config readahead fixed 32" "as 1" "read 0" "read 0" "stats"
+# A shared CLOCK-Pro replacer can offer the new page's frame first
+expect "readahead keeps the faulting page (global)" "Page hits: 1" \
+    "init 4096" "set policy CLOCK-PRO" "config readahead fixed 32" "read 6208" "read 11200" \
+    "read 3520" "read 6912" "read 11840" "read 448" "read 448" "stats"
+
+# RAM must hold a page, or a fault finds no frame to evict
+expect "init refuses RAM smaller than a page" "Invalid memory size: RAM must hold at least one page" \
+    "init 32" "read 0"
+expect "config vm refuses pages larger than RAM" "Invalid VM configuration: RAM must hold at least one page" \
+    "config vm 48 2048 4" "read 0"
+
+# Numbers in a trace must fit 64 bits and end at a separator
+expect_trace "trace numbers reject junk and overflow" "Warning: skipped 4 unparsable trace lines" native \
+    "read 12zz" "read 0x" "read 18446744073709551616" "write 64@x" "read 0x40" "write 64 @0" "read 18446744073709551615"
+expect_trace "lackey addresses end at the size" "Warning: skipped 1 unparsable trace lines" lackey \
+    "I  0400d7d4,8" " L 04222cac,8" " S 0422zz,8" " M 04222cb0,4"
+
+# Page 0 of ASID 1 and page 2^48 of ASID 0 are different pages
+expect "page profile keys pages above 48 bits apart" "[Pages] 2 references, 2 distinct" \
+    "config vm 64 64 4" "mrc on" "as 1" "read 0" "as 0" "read 18014398509481984" "stats"
+
+exit $failed